@@ -0,0 +1,62 @@
+#!/usr/bin/env bash
+# Measures how long `mule build` takes when nothing changed.
+#
+# Generates a project with FILES sources (default 1000), builds it once, then times RUNS
+# no-op builds (default 20) and fails if the median exceeds LIMIT_MS (default 50).
+#
+# Usage: bench/noop_build.sh [path/to/mule]
+set -euo pipefail
+
+MULE="${1:-mule}"
+MULE="$(command -v "$MULE" || realpath "$MULE")"
+FILES="${FILES:-1000}"
+RUNS="${RUNS:-20}"
+LIMIT_MS="${LIMIT_MS:-50}"
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+export MULE_CACHE_DIR="$WORK/cache"
+
+cd "$WORK"
+mkdir -p src include
+cat > mule.toml <<TOML
+[package]
+name = "noop_bench"
+version = "0.1.0"
+standard = "17"
+TOML
+
+# Each source includes a couple of headers so the dependency graph is realistic
+for ((i = 0; i < FILES; i++)); do
+    printf 'inline int h%d() { return %d; }\n' "$i" "$i" > "include/h$i.h"
+    printf '#include "h%d.h"\n#include "h%d.h"\nint f%d() { return h%d() + h%d(); }\n' \
+        "$i" "$(( (i + 1) % FILES ))" "$i" "$i" "$(( (i + 1) % FILES ))" > "src/f$i.cpp"
+done
+echo 'int main() { return 0; }' > src/main.cpp
+
+echo "Building $FILES sources once..."
+"$MULE" build > /dev/null
+
+now_ns() { date +%s%N; }
+times=()
+for ((run = 0; run < RUNS; run++)); do
+    start=$(now_ns)
+    "$MULE" build > /dev/null
+    end=$(now_ns)
+    times+=($(( (end - start) / 1000 )))
+done
+
+sorted=($(printf '%s\n' "${times[@]}" | sort -n))
+median_us=${sorted[$(( RUNS / 2 ))]}
+min_us=${sorted[0]}
+max_us=${sorted[$(( RUNS - 1 ))]}
+
+printf 'No-op build (%d files, %d runs): median %d.%03d ms, min %d.%03d ms, max %d.%03d ms\n' \
+    "$FILES" "$RUNS" $(( median_us / 1000 )) $(( median_us % 1000 )) \
+    $(( min_us / 1000 )) $(( min_us % 1000 )) $(( max_us / 1000 )) $(( max_us % 1000 ))
+
+if (( median_us > LIMIT_MS * 1000 )); then
+    echo "FAIL: median exceeds ${LIMIT_MS} ms" >&2
+    exit 1
+fi
+echo "OK: under ${LIMIT_MS} ms"
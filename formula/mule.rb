@@ -10,7 +10,7 @@ class Mule < Formula
 
   def install
     # Build from source
-    system "g++", "-std=c++17", "src/main.cpp", *Dir["src/core/*.cpp"], "-o", "mule"
+    system "g++", "-std=c++17", "-pthread", "src/main.cpp", *Dir["src/core/*.cpp"], "-o", "mule"
     bin.install "mule"
   end
 
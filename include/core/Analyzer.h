@@ -0,0 +1,39 @@
+#pragma once
+#include "Builder.h"
+#include <string>
+#include <vector>
+#include <map>
+
+namespace mule {
+    // Aggregated clang -ftime-trace data over every translation unit of a build.
+    struct TimeTraceSummary {
+        struct Header {
+            double total_ms = 0;   // Inclusive parse time (the header and all it includes), summed
+            size_t tus = 0;        // Translation units that included it
+            size_t fan_out = 0;    // Most headers it pulled in within a single TU
+        };
+        struct Entry {
+            double total_ms = 0;
+            size_t count = 0;
+        };
+
+        size_t units = 0;
+        double frontend_ms = 0;
+        double backend_ms = 0;
+        std::map<std::string, Header> headers;
+        std::map<std::string, Entry> instantiations; // Class and function template instantiations
+        std::map<std::string, Entry> codegen;        // Code generation per function
+    };
+
+    class Analyzer {
+    public:
+        // mule analyze headers: rebuilds every TU with clang's -ftime-trace (bypassing the
+        // compile cache) and prints the most expensive headers, template instantiations and
+        // functions.
+        static int analyze_headers(const Config& config, const BuildOptions& options, size_t top);
+
+        // Adds one -ftime-trace JSON file to summary. Returns false if it cannot be parsed.
+        static bool add_trace(const std::string& path, TimeTraceSummary& summary);
+        static void print_report(const TimeTraceSummary& summary, size_t top);
+    };
+}
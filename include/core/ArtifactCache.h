@@ -0,0 +1,25 @@
+#pragma once
+#include "ConfigParser.h"
+#include <string>
+
+namespace mule {
+    // Installed builds of git dependencies (libraries, headers, CMake and pkg-config files),
+    // shared by every project on the machine. An artifact is keyed on everything the build
+    // depends on: the commit (and subdir), the toolchain, the C++ standard and the build
+    // type. Artifacts are looked up in <cache_dir>/artifacts and then in every directory of
+    // $MULE_ARTIFACT_PATH (':'-separated, ';' on Windows), which are never written to, so a
+    // CI image can ship a read-only directory with every dependency prebuilt.
+    class ArtifactCache {
+    public:
+        static std::string key(const Dependency& dep, const std::string& toolchain_identity,
+                               const std::string& standard, const std::string& build_type);
+
+        // Fills the empty install prefix with the artifact, hardlinking its files where the
+        // filesystem allows and rewriting the old prefix in CMake and pkg-config files.
+        // Returns false on a miss.
+        static bool restore(const std::string& key, const std::string& prefix);
+        // Copies the install prefix into the local cache, unless it already has key. The entry
+        // appears in one rename, so concurrent readers never see half of it.
+        static void store(const std::string& key, const std::string& prefix);
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+namespace mule {
+    // mtime and size of a step's inputs, taken before the step runs, so that recording its
+    // output can tell whether an input was saved while it ran.
+    struct InputSnapshot {
+        std::unordered_map<std::string, std::pair<int64_t, uint64_t>> files; // Missing files are left out
+        std::unordered_set<std::string> unchecked; // Inputs other steps of the build produce, e.g. module BMIs
+        int64_t taken = 0; // File clock ticks; 0 = no snapshot, nothing is checked
+    };
+
+    // Persistent record of what every build output was produced from, stored in
+    // .mule/build.db. An output is up to date when it exists, was produced by the same
+    // command and all of its inputs still have the same content hash.
+    class BuildDb {
+    public:
+        static constexpr const char* DEFAULT_PATH = ".mule/build.db";
+
+        bool load(const std::string& path = DEFAULT_PATH);
+        bool save(const std::string& path = DEFAULT_PATH);
+
+        // Content hash of a file. The hash is only recomputed when the file's size or
+        // mtime differ from the cached entry. Returns false if the file does not exist.
+        bool file_hash(const std::string& path, uint64_t& out_hash);
+
+        // Files below these directories are not looked at on disk again once hashed, until
+        // invalidate() reports that they changed. Used by mule watch, which learns about
+        // every change below the directories it watches from the file system.
+        void set_trusted_roots(const std::vector<std::string>& roots);
+        void invalidate(const std::string& path);
+        void invalidate_all() { verified_.clear(); }
+
+        bool is_up_to_date(const std::string& output, const std::string& command);
+        // Inputs recorded for output, empty if it was never built.
+        std::vector<std::string> inputs_of(const std::string& output) const;
+        // Snapshot of paths and of the inputs recorded for output, to pass to record(). Inputs
+        // in unchecked are expected to change while the build runs and are left out.
+        InputSnapshot snapshot(const std::string& output, const std::vector<std::string>& paths,
+                               const std::vector<std::string>& unchecked = {}) const;
+        // Records that output was just produced by command from inputs. With a snapshot, an
+        // input that changed since it was taken (or that is newer than the snapshot and not
+        // in it, such as a header the step newly included) means the output may be built
+        // from the old content: it is forgotten instead, so the next build redoes it.
+        // Returns false if output was not recorded.
+        bool record(const std::string& output, const std::string& command, const std::vector<std::string>& inputs,
+                    const InputSnapshot& before = {});
+
+        // What producing output cost the last time it was built. Kept across record() calls
+        // that do not run the command (e.g. compile cache hits).
+        void record_cost(const std::string& output, double wall_ms, long peak_rss_kb);
+        // Returns false if output was never built and measured.
+        bool cost_of(const std::string& output, double& wall_ms, long& peak_rss_kb) const;
+
+    private:
+        struct FileEntry {
+            int64_t mtime = 0;
+            uint64_t size = 0;
+            uint64_t hash = 0;
+        };
+
+        struct OutputEntry {
+            uint64_t command_hash = 0;
+            uint64_t input_hash = 0;
+            std::vector<std::string> inputs;
+            double wall_ms = 0;   // 0 = never measured
+            int64_t peak_rss_kb = 0;
+        };
+
+        bool inputs_hash(const std::vector<std::string>& inputs, uint64_t& out_hash);
+        bool is_trusted(const std::string& path) const;
+
+        std::unordered_map<std::string, FileEntry> files_;
+        std::unordered_map<std::string, OutputEntry> outputs_;
+        std::unordered_set<std::string> verified_; // Hashed since the last invalidation
+        std::vector<std::string> trusted_roots_;
+        bool dirty_ = false;
+    };
+}
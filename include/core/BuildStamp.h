@@ -0,0 +1,21 @@
+#pragma once
+#include "Builder.h"
+#include <string>
+#include <vector>
+
+namespace mule {
+    // Snapshot of everything the last successful build depended on: mule.toml, mule.lock,
+    // the toolchain, the mtime and size of every input and output, and the mtimes of the
+    // source directories (so added or removed files are noticed). When none of it changed,
+    // mule build is done without resolving dependencies or even loading the build database.
+    class BuildStamp {
+    public:
+        static constexpr const char* PATH = ".mule/stamps/build";
+
+        // True if the stamp proves the build is up to date; target is set to its output.
+        static bool is_current(const BuildOptions& options, std::string& target);
+        static void write(const BuildOptions& options, const std::string& target,
+                          const std::vector<std::string>& files, const std::vector<std::string>& dirs);
+        static void invalidate();
+    };
+}
@@ -1,13 +1,85 @@
 #pragma once
 #include "ConfigParser.h"
+#include "BuildDb.h"
+#include "PackageManager.h"
 #include <string>
+#include <vector>
 
 namespace mule {
+    struct BuildOptions {
+        int jobs = 0;          // Parallel compile jobs, 0 = hardware concurrency
+        bool use_cache = true; // Look up and store objects in the shared compile cache
+        bool unity = false;    // Compile sources in unity batches
+        bool timings = false;  // Record every step and write build/timings/
+        bool time_trace = false; // Clang only: write a -ftime-trace JSON next to every object
+        bool rebuild = false;    // Recompile every project source, even the up to date ones
+        long mem_limit_kb = 0;   // Budget for the peak RSS of concurrent jobs, 0 = 80% of available RAM
+        bool release = false;    // Release profile: optimized, NDEBUG, Release dependency builds
+        bool offline = false;    // Resolve dependencies from mule.lock and the store, never fetch
+        bool locked = false;     // Fail instead of updating mule.lock
+    };
+
+    struct PrecompiledHeader {
+        std::string compile_flags;       // Added to every TU that should use the PCH
+        std::string object;              // MSVC only: object that must be linked in
+        std::vector<std::string> inputs; // Headers baked into the PCH
+    };
+
+    // State a long-running command (mule watch) keeps between builds, so a rebuild only
+    // pays for what changed. A default constructed session resolves everything afresh.
+    struct BuildSession {
+        bool prepared = false;             // Toolchain, pkg-config and dependencies resolved
+        CompilerType compiler_type = CompilerType::Unknown;
+        std::string compiler_cmd;
+        std::string compiler_identity;     // Compile cache key prefix
+        std::string nvcc_cmd;              // Empty if nvcc is not in PATH
+        Config active_config;              // Config after pkg-config and dependency expansion
+        std::string dependency_flags;      // Include paths of .mule/deps
+        std::vector<Dependency> dependencies; // As resolved by the last fetch
+        std::vector<DependencyBuild> dependency_builds; // Out of date CMake and Make dependencies
+        std::vector<MulePackage> packages; // Dependencies that are Mule projects, dependencies first
+        bool dependencies_built = false;   // dependency_builds have run in this session
+        bool sources_indexed = false;      // Cleared when files are added to or removed from src/
+        std::vector<std::string> src_files; // Every file below src/
+        bool db_loaded = false;
+        BuildDb db;
+    };
+
+    // A test executable built by Builder::build_tests.
+    struct TestBinary {
+        std::string name;   // "unit_tests", or the name of the file in tests/
+        std::string path;
+        bool built = false; // False if it, or something it links, failed to build
+    };
+
     class Builder {
     public:
-        static void build(const Config& config);
-        static void run(const Config& config);
+        static bool build(const Config& config, const BuildOptions& options = {});
+        static bool build(const Config& config, const BuildOptions& options, BuildSession& session);
+        // Builds every member of root's [workspace] in one scheduler run, into root's build/:
+        // the objects of all members compile side by side and each member is archived or
+        // linked as soon as its own objects and the libraries of the members it depends on
+        // are done.
+        static bool build_workspace(const Config& root, const BuildOptions& options = {});
+        // Builds the test executables in one scheduler run: build/unit_tests from the
+        // *_test.cpp files in src/ plus a generated main, and build/test_<name> for every file
+        // in tests/. The library sources (src/ minus main.cpp and unit tests) compile once,
+        // with the flags and into the objects build uses, and are archived into build/tests/
+        // for every test to link together with the project's dependencies. Test sources
+        // only recompile when they change. Returns false if no test could be built.
+        static bool build_tests(const Config& config, const BuildOptions& options, std::vector<TestBinary>& out);
+        // Runs the already built project binary.
+        static void run_binary(const Config& config);
+        static void run(const Config& config, const BuildOptions& options = {});
         static void clean();
         static CompilerType detect_compiler(std::string& out_cmd);
+        // Include paths, flags and defines every project TU is compiled with.
+        static std::string compile_flags(const Config& config, CompilerType type);
+        // Include paths of the dependencies fetched into .mule/deps.
+        static std::string dependency_include_flags(CompilerType type);
+        // Builds the [build] pch header for this compiler and set of flags unless an up to
+        // date one exists. Does nothing when no pch is configured.
+        static bool prepare_pch(const Config& config, CompilerType type, const std::string& compiler_cmd,
+                                const std::string& flags, BuildDb& db, PrecompiledHeader& out);
     };
 }
@@ -0,0 +1,50 @@
+#pragma once
+#include "BuildDb.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace mule {
+    // Content-addressed object cache shared by every project on the machine, in the
+    // spirit of ccache's direct mode. A manifest keyed on the compiler identity, the
+    // normalized command line and the source content lists the headers each previous
+    // compilation included together with their hashes; when they all still match, the
+    // stored object is copied into place instead of compiling.
+    class CompileCache {
+    public:
+        explicit CompileCache(const std::string& compiler_identity);
+
+        // $MULE_CACHE_DIR, else $XDG_CACHE_HOME/mule, else ~/.cache/mule.
+        static std::string cache_dir();
+        static void print_stats();
+        // Removes the cached objects and manifests and the ArtifactCache entries.
+        static void clear();
+        // Counts bytes the ArtifactCache stored under cache_dir() toward the size limit,
+        // evicting least recently used entries if it is exceeded.
+        static void add_size(uint64_t bytes);
+
+        // Restores obj and its depfile from the cache. Returns false on a miss.
+        bool fetch(BuildDb& db, const std::string& command, const std::string& src,
+                   const std::string& obj, const std::string& depfile);
+        // Stores a freshly compiled obj and the headers listed in its depfile. extra_inputs
+        // are files the object also depends on that the depfile does not list, such as the
+        // headers baked into a precompiled header.
+        void store(BuildDb& db, const std::string& command, const std::string& src,
+                   const std::string& obj, const std::string& depfile,
+                   const std::vector<std::string>& extra_inputs = {});
+        // Flushes hit/miss counters and evicts least recently used entries (objects,
+        // manifests and whole artifacts) when the cache grew past its size limit
+        // ($MULE_CACHE_SIZE, default 5G).
+        void finish();
+
+    private:
+        bool manifest_key(BuildDb& db, const std::string& command, const std::string& src, uint64_t& out_key);
+
+        std::string dir_;
+        std::string identity_;
+        std::string cwd_;
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+        uint64_t added_bytes_ = 0;
+    };
+}
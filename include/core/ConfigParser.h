@@ -12,7 +12,8 @@ namespace mule {
         std::string tag;
         std::string commit;
         std::string path;    
-        std::string version; 
+        std::string version; // Required [package] version of a Mule dependency: "1.2" accepts 1.2 and 1.2.x
+        std::string subdir;  // Directory of a git dependency inside its repository (monorepos)
     };
 
     struct GeneratorConfig {
@@ -30,6 +31,9 @@ namespace mule {
         std::vector<std::string> flags;
         std::vector<std::string> linker_flags;
         std::vector<std::string> defines;
+        std::string pch; // Header to precompile and force-include in every TU
+        int unity_batch = 0; // Sources per unity batch, 0 = unity builds off
+        std::vector<std::string> unity_exclude; // Sources always compiled on their own
     };
 
     struct QtConfig {
@@ -41,6 +45,10 @@ namespace mule {
         bool enabled = false;
     };
 
+    struct WorkspaceConfig {
+        std::vector<std::string> members; // Package directories; "dir/*" = every subdirectory of dir with a mule.toml
+    };
+
     struct Config {
         std::string project_name;
         std::string version;
@@ -51,10 +59,13 @@ namespace mule {
         std::vector<GeneratorConfig> generators;
         QtConfig qt;
         CudaConfig cuda;
+        WorkspaceConfig workspace; // Empty members unless this is a workspace root
     };
 
     class ConfigParser {
     public:
+        // Throws std::runtime_error, naming the file and line, if the file is malformed
+        // (e.g. a lockfile cut off mid-line).
         static Config parse(const std::string& filename);
     };
 }
@@ -0,0 +1,17 @@
+#pragma once
+#include "ConfigParser.h"
+#include <string>
+#include <vector>
+
+namespace mule {
+    class DepTracker {
+    public:
+        // Path of the dependency file the compiler writes next to obj.
+        static std::string depfile_path(const std::string& obj, CompilerType type);
+        // Compiler flags that make it write the dependency file while compiling.
+        static std::string depfile_flags(const std::string& depfile, CompilerType type);
+        // Reads a Make-style (.d) or MSVC /sourceDependencies (.json) file and returns every
+        // file the object was built from, the source itself included.
+        static std::vector<std::string> parse_depfile(const std::string& depfile);
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace mule {
+    enum class JobStatus { Pending, Succeeded, Failed, Skipped };
+
+    struct Job {
+        std::string description;     // Printed when the job starts, e.g. "Compiling: main.cpp"
+        std::string command;
+        std::string failure_message; // Printed after the job's output if it fails
+        std::vector<size_t> deps;    // Indices of jobs that must succeed before this one starts
+        std::string response_file;   // Used as @file if the command line is too long, empty = never
+        double estimate_ms = 0;      // Expected duration; the longest chains of work start first
+        long memory_kb = 0;          // Expected peak RSS, counted against the memory budget
+        // Called right before the job starts, to finish a command that depends on what
+        // earlier jobs produced (e.g. the libraries a dependency installed)
+        std::function<void(Job&)> prepare;
+        JobStatus status = JobStatus::Pending;
+        // Measured while the job ran
+        int slot = 0;           // Worker that ran it, from 1
+        double start_ms = 0;    // Since JobScheduler::run started
+        double wall_ms = 0;
+        double cpu_ms = 0;
+        long peak_rss_kb = 0;
+    };
+
+    class JobScheduler {
+    public:
+        // Number of workers used when no -j limit is given.
+        static int default_jobs();
+        // Memory budget used when no --mem-limit is given: 80% of the memory the system
+        // reports as available. 0 (no budget) where that cannot be determined.
+        static long default_memory_budget_kb();
+
+        // Runs the job graph on up to max_jobs workers. Of the jobs that are ready, the one
+        // with the longest estimated path to the end of the graph starts first. With a memory
+        // budget (in KiB, 0 = none), a job only starts while the expected peak RSS of all
+        // running jobs stays within it; smaller ready jobs fill the remaining workers, and a
+        // job larger than the whole budget runs alone. Every job running alongside another
+        // one also holds a jobserver token, when there is a jobserver. Each job's output is
+        // buffered and printed in one piece. After the first failure no new job is started,
+        // jobs already running are allowed to finish and everything still pending is marked
+        // Skipped.
+        static bool run(std::vector<Job>& jobs, int max_jobs, long memory_budget_kb = 0);
+
+        // Wall time the graph should take according to the estimates, either in critical-path
+        // order (as run() does) or in the order the jobs were added.
+        static double predict_makespan(const std::vector<Job>& jobs, int max_jobs, long memory_budget_kb, bool critical_path_first = true);
+    };
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+
+namespace mule {
+    // GNU make jobserver (pipe protocol, plus the fifo form of make 4.4 when joining one).
+    // Mule joins the jobserver of a make it runs under, or creates its own and advertises it
+    // in MAKEFLAGS, so the make and cmake builds of dependencies take their job slots from
+    // the same pool as Mule's own compiles.
+    class Jobserver {
+    public:
+        // Joins the jobserver named in MAKEFLAGS, or else creates one with `jobs` slots.
+        // Only the first call has an effect.
+        static void init(int jobs);
+        // True if Mule joined the jobserver of an outer make.
+        static bool is_client();
+
+        // Every process owns one implicit slot; each job running beyond it needs a token.
+        // Blocks until one is free. Returns false (and the job just runs) when there is no
+        // jobserver.
+        static bool acquire(char& token);
+        // Gives back a token obtained from acquire().
+        static void release(char token);
+    };
+}
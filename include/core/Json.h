@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+
+namespace mule {
+    // Minimal JSON document model for reading compiler-produced files (P1689 module
+    // dependency files, -ftime-trace output).
+    class JsonValue {
+    public:
+        enum class Type { Null, Bool, Number, String, Array, Object };
+
+        Type type = Type::Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> array;
+        std::map<std::string, JsonValue> object;
+
+        bool is_null() const { return type == Type::Null; }
+        // Member lookup; yields a null value when this is not an object or the key is missing.
+        const JsonValue& operator[](const std::string& key) const;
+
+        static bool parse(const std::string& text, JsonValue& out);
+        // text as a JSON string literal, quotes included.
+        static std::string quote(const std::string& text);
+    };
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "ConfigParser.h"
+#include "BuildDb.h"
+#include <string>
+#include <vector>
+#include <map>
+
+namespace mule {
+    // What a translation unit contributes to the C++20 module graph.
+    struct ModuleInfo {
+        std::string provides;              // Module (or "module:partition") this TU is the interface of
+        std::vector<std::string> imports; // Modules it imports, or implements for "module foo;"
+    };
+
+    // Finds module provides and imports of each TU, either with clang-scan-deps (P1689 output)
+    // or with a built-in scanner of module and import declarations. Results are cached in
+    // .mule/modules.scan keyed on the source's content hash.
+    class ModuleScanner {
+    public:
+        static constexpr const char* CACHE_PATH = ".mule/modules.scan";
+
+        // True for the dedicated module interface extensions (.cppm, .ixx, .mpp).
+        static bool is_interface_extension(const std::string& path);
+        // True when the language standard (e.g. "20", "2b") supports named modules.
+        static bool standard_has_modules(const std::string& standard);
+
+        explicit ModuleScanner(CompilerType type);
+        void load();
+        void save();
+
+        // compile_cmd is the command that will compile src; clang-scan-deps needs it.
+        bool scan(BuildDb& db, const std::string& src, const std::string& compile_cmd, ModuleInfo& out);
+
+        static ModuleInfo scan_declarations(const std::string& content);
+        static bool parse_p1689(const std::string& json, ModuleInfo& out);
+
+    private:
+        struct CacheEntry {
+            uint64_t hash = 0;
+            ModuleInfo info;
+        };
+
+        std::string scanner_;
+        std::map<std::string, CacheEntry> cache_;
+        bool dirty_ = false;
+    };
+}
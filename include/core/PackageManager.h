@@ -1,11 +1,75 @@
 #pragma once
 #include "ConfigParser.h"
+#include "JobScheduler.h"
 
 namespace mule {
+    // The CMake or Make build of one dependency that is out of date.
+    struct DependencyBuild {
+        std::string name;
+        std::string path;      // .mule/deps/<name>
+        bool is_path = false;  // Path dependency, stamped by content instead of commit
+        std::string build_dir; // CMake build directory, or the copy a git Make dependency builds in
+        std::string install_dir; // CMake: install prefix, whose include/ is on the project's include path
+        std::string key;       // Hash of the commit, toolchain and build commands
+        std::string artifact_key; // ArtifactCache key of the install, empty if it is not cached
+        bool restored = false;    // Installed from the artifact cache, nothing left to run
+        std::vector<Job> jobs; // Configure step (if any) first; deps index into this list
+    };
+
+    // A dependency that is itself a Mule project (has a mule.toml). Mule compiles its
+    // library sources in the project's own build rather than handing it to CMake or Make.
+    struct MulePackage {
+        std::string name;
+        std::string path;                      // .mule/deps/<name>
+        Config config;                         // Its mule.toml; paths are relative to path
+        std::vector<std::string> dependencies; // Names of the packages it links against
+    };
+
+    struct FetchOptions {
+        bool offline = false; // Never fetch; a commit the store does not have is an error
+        bool locked = false;  // mule.lock must exist and match mule.toml, it is not rewritten
+        bool update = false;  // Ignore mule.lock: re-resolve tags and unpinned dependencies
+    };
+
     class PackageManager {
     public:
-        static std::vector<Dependency> fetch_dependencies(const std::vector<Dependency>& deps);
-        static void build_dependencies(const std::vector<Dependency>& deps, CompilerType compiler_type);
+        // Links path dependencies and git dependencies into .mule/deps. Git dependencies live
+        // in the machine-wide Store (several fetched at a time); .mule/deps/<name> links to the
+        // worktree of the pinned commit, or to its subdir. A git dependency whose mule.lock
+        // entry still matches mule.toml is pinned to the locked commit; while its checkout is
+        // at that commit (read from .git/HEAD, no git process) it is used as is. The
+        // [dependencies] of dependencies that are Mule projects are fetched as well, once per
+        // name; resolved lists the whole graph. Returns false if a dependency could not be
+        // resolved, two packages require different sources or versions of one dependency, or
+        // with options.locked if mule.lock would have to change.
+        static bool fetch_dependencies(const std::vector<Dependency>& deps, const FetchOptions& options,
+                                       std::vector<Dependency>& resolved);
+        // The Mule packages among the resolved dependencies, each after the packages it
+        // depends on. Returns false on a dependency cycle.
+        static bool mule_packages(const std::vector<Dependency>& resolved, std::vector<MulePackage>& out);
+        // The CMake and Make dependencies among deps that need building; Mule packages are
+        // left to the Builder. CMake dependencies are configured with build_type, the
+        // project's C++ standard (and Ninja when it is in PATH) in .mule/build/<name> and
+        // installed into .mule/install/<name>. Make dependencies from git build in a private
+        // copy of their worktree in .mule/build/<name>, path ones in place. A dependency is
+        // skipped while its stamp in .mule/stamps/deps/<name> matches: same commit (or, for
+        // path dependencies, same file contents), toolchain and build commands. With
+        // use_artifacts, a git dependency's install is restored from the ArtifactCache when it
+        // has one; such builds come back marked restored, without jobs. Different dependencies
+        // do not depend on each other, so the scheduler builds them side by side; nested make
+        // processes share Mule's job slots through the jobserver.
+        static std::vector<DependencyBuild> dependency_builds(const std::vector<Dependency>& deps, const std::string& toolchain_identity,
+                                                              const std::string& standard, const std::string& build_type,
+                                                              int parallel_jobs, bool use_artifacts);
+        // Records that build succeeded, so it is skipped until its inputs change, and adds a
+        // fresh install to the artifact cache.
+        static void write_dependency_stamp(const DependencyBuild& build);
+        // Adds the libraries of deps to config's link flags: for CMake dependencies the exact
+        // files their installed CMake package (or else pkg-config file) names, for Make and
+        // prebuilt ones their lib/ and build/ directories. Mule packages are skipped.
+        static void link_dependencies(const std::vector<Dependency>& deps, const std::string& build_type, Config& config);
         static void write_lockfile(const std::vector<Dependency>& resolved);
+        // .mule/install/<name>, where a CMake dependency is installed.
+        static std::string install_dir(const std::string& name);
     };
 }
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace mule {
+    struct ProcessResult {
+        int exit_code = -1;   // -1 if the process could not be started or was killed by a signal
+        std::string output;   // What the process printed, if captured
+        double wall_ms = 0;
+        double cpu_ms = 0;    // User plus system time
+        long peak_rss_kb = 0; // Peak resident set size, 0 where the platform does not report it
+    };
+
+    struct ProcessOptions {
+        bool capture = true;        // Collect output in the result instead of the terminal
+        bool merge_stderr = true;   // With capture, also collect stderr (interleaved with stdout)
+        std::string cwd;            // Working directory of the child, empty for the current one
+        std::string response_file;  // Where to move the arguments (passed as @file) when the
+                                    // command line is too long; empty to never do so
+    };
+
+    // Runs programs directly with posix_spawn: no shell, arguments passed as given.
+    class Process {
+    public:
+        // Command lines longer than this use the response file, if one is allowed.
+        static const size_t RESPONSE_FILE_THRESHOLD;
+
+        static ProcessResult run(const std::vector<std::string>& args, const ProcessOptions& options = {});
+        // Runs a command line. It is split into arguments like a shell would split plain words
+        // and quotes; commands that rely on redirection, pipes or globs go through the shell.
+        static ProcessResult run(const std::string& command, const ProcessOptions& options = {});
+
+        static std::vector<std::string> split(const std::string& command);
+        // Quotes arg for a command line (or response file) if it contains special characters.
+        static std::string quote(const std::string& arg);
+        static bool needs_shell(const std::string& command);
+    };
+}
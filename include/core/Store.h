@@ -0,0 +1,36 @@
+#pragma once
+#include "ConfigParser.h"
+#include <string>
+
+namespace mule {
+    // Machine-wide store of git dependencies, shared by every project on the host: one bare
+    // mirror per repository URL and one worktree per pinned commit. Projects only hold
+    // symlinks into it (.mule/deps/<name>) and register themselves, so that gc can tell
+    // which commits some lockfile still references.
+    //
+    //   <root>/mirrors/<url hash>.git              bare, partial (blobs on demand) mirror
+    //   <root>/worktrees/<url hash>/<commit>       checkout of that commit
+    //   <root>/worktrees/<url hash>/<commit>-<h>   sparse checkout of one subdir
+    //   <root>/projects/<path hash>                absolute path of a project using the store
+    class Store {
+    public:
+        // $MULE_HOME/store, else ~/.mule/store.
+        static std::string root();
+
+        // Fetches dep's pinned tag or commit (or, when unpinned, the remote's default
+        // branch) into its mirror unless the mirror already has it, and makes sure a worktree
+        // of that commit exists. Mirrors are locked while they change, so several projects
+        // can fetch at once. Sets out_commit and out_checkout (the worktree, or the subdir
+        // inside it); git's output goes to log. fetched tells whether the network was used.
+        // With offline, a revision the mirror does not have yet is an error instead. With
+        // update, a tag is fetched again even if the mirror has it, in case it moved.
+        static bool materialize(const Dependency& dep, bool offline, bool update, std::string& out_commit, std::string& out_checkout,
+                                bool& fetched, std::string& log);
+        // Remembers that the project in project_dir uses the store.
+        static void register_project(const std::string& project_dir);
+
+        // Removes the worktrees of commits that no registered project's mule.lock references,
+        // and mirrors left without any. Projects that no longer exist are forgotten.
+        static int gc();
+    };
+}
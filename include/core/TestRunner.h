@@ -1,9 +1,11 @@
 #pragma once
 #include "ConfigParser.h"
+#include "Builder.h"
 
 namespace mule {
     class TestRunner {
     public:
-        static void run_tests(const Config& config);
+        // Builds the tests with Builder::build_tests and runs every one that built.
+        static void run_tests(const Config& config, const BuildOptions& options = {});
     };
 }
@@ -0,0 +1,45 @@
+#pragma once
+#include "Process.h"
+#include <string>
+#include <vector>
+
+namespace mule {
+    struct TimingEvent {
+        std::string name;         // e.g. "Compiling: main.cpp"
+        std::string category;     // probe, fetch, dependency, generate, pch, compile, link
+        int slot = 0;             // Scheduler worker that ran it, 0 for the main thread
+        double start_ms = 0;      // Since the build started
+        double duration_ms = 0;
+        double cpu_ms = 0;
+        long peak_rss_kb = 0;
+        std::vector<size_t> deps; // Events that had to finish first (indices)
+    };
+
+    // Collects a TimingEvent for every step of a build run with --timings and writes
+    // build/timings/trace.json (Chrome trace events, loadable in Perfetto or
+    // chrome://tracing), build/timings/report.html and a summary of the slowest units and
+    // the critical path. Totals are appended to .mule/timings.history for comparison.
+    class Timings {
+    public:
+        static constexpr const char* TRACE_PATH = "build/timings/trace.json";
+        static constexpr const char* REPORT_PATH = "build/timings/report.html";
+        static constexpr const char* HISTORY_PATH = ".mule/timings.history";
+        static const size_t HISTORY_LIMIT = 50;
+
+        // Starts recording; a no-op for every other call until begin() has been called.
+        static void begin();
+        static bool enabled();
+        static double now_ms();
+
+        // Returns the index of the recorded event, or 0 when not recording.
+        static size_t record(const TimingEvent& event);
+        // Runs a process and records it as one step.
+        static ProcessResult run(const std::string& name, const std::string& category,
+                                 const std::vector<std::string>& args, const ProcessOptions& options = {});
+        static ProcessResult run(const std::string& name, const std::string& category,
+                                 const std::string& command, const ProcessOptions& options = {});
+
+        // Writes the trace, report and history, prints the summary and stops recording.
+        static void finish(bool success);
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "ConfigParser.h"
+#include <string>
+#include <cstdint>
+
+namespace mule {
+    struct ToolchainInfo {
+        CompilerType type = CompilerType::Unknown;
+        std::string command;  // How the compiler is invoked, e.g. "g++"
+        std::string path;     // Where PATH resolved it
+        int64_t mtime = 0;    // Of the resolved binary, to notice upgrades
+        std::string version;  // First line of the version banner
+        std::string triple;   // Target, from -dumpmachine (empty for MSVC)
+        std::string nvcc;     // nvcc command if one is in PATH, else empty
+
+        // Identifies the compiler for caches: same identity, same generated code.
+        std::string identity() const { return command + "\n" + version + "\n" + triple; }
+    };
+
+    // Finds the compiler with an in-process PATH search and remembers its version and target
+    // in .mule/toolchain, so later runs only probe it again when the binary changes.
+    class Toolchain {
+    public:
+        static constexpr const char* CACHE_PATH = ".mule/toolchain";
+
+        // Picks clang++, g++ or cl, in that order. Returns false if none is in PATH.
+        static bool detect(ToolchainInfo& out);
+        // Only the PATH search of detect: sets type, command, path and mtime without running
+        // or probing the compiler.
+        static bool locate(ToolchainInfo& out);
+    };
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace mule {
+    class UnityBuild {
+    public:
+        static constexpr size_t DEFAULT_BATCH_SIZE = 16;
+
+        // Groups sources into batches of about batch_size files and writes one
+        // build/unity/unity_<id>.cpp per batch that #includes them. Batch boundaries are
+        // derived from the file paths themselves, so adding or removing one source only
+        // changes the batch it lands in. Returns the generated unity sources.
+        static std::vector<std::string> generate(std::vector<std::string> sources, size_t batch_size);
+    };
+}
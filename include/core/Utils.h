@@ -1,11 +1,39 @@
 #pragma once
 #include <string>
 #include <cstdlib>
+#include <cstdint>
 
 namespace mule {
     bool command_exists(const std::string& cmd);
+    // Looks cmd up in PATH without running anything. Returns its path, or "" if not found.
+    std::string find_executable(const std::string& cmd);
     void print_version();
     std::string get_exe_ext();
     std::string exec_cmd(const char* cmd);
+    // Runs cmd with stderr merged into stdout, stores everything it printed in output and
+    // returns its exit status (0 on success).
+    int exec_cmd_status(const std::string& cmd, std::string& output);
+    // 64-bit FNV-1a, used for build database and cache keys.
+    uint64_t hash_string(const std::string& data, uint64_t seed = 14695981039346656037ULL);
+    // Fixed-width lowercase hex, e.g. for hash-named files.
+    std::string to_hex(uint64_t value);
+    // Parses a size such as "512M" or "5G" (K, M, G, T are powers of 1024; no unit = bytes).
+    // Returns false if value is not a positive size.
+    bool parse_size(const std::string& value, uint64_t& out_bytes);
+    // Hashes the contents of a file. Returns false if it cannot be read.
+    bool hash_file(const std::string& path, uint64_t& out_hash);
     const std::string VERSION = "0.2.0-dev";
+
+    // Exclusive lock on a lock file, held across processes until destruction. Each lock opens
+    // the file anew, so threads of one process exclude each other as well. A no-op on Windows.
+    class FileLock {
+    public:
+        explicit FileLock(const std::string& path);
+        ~FileLock();
+        FileLock(const FileLock&) = delete;
+        FileLock& operator=(const FileLock&) = delete;
+
+    private:
+        int fd_ = -1;
+    };
 }
@@ -0,0 +1,22 @@
+#pragma once
+#include "Builder.h"
+
+namespace mule {
+    struct WatchOptions {
+        bool run = false;    // Run the binary after every successful build
+        bool test = false;   // Run the test suite after every successful build
+        bool daemon = false; // Detach from the terminal and log to .mule/watch.log
+    };
+
+    // mule watch: keeps the config, source index and build database in memory and rebuilds
+    // whenever inotify reports a change to src/, include/, tests/ or mule.toml.
+    class Watcher {
+    public:
+        static constexpr const char* PID_PATH = ".mule/watch.pid";
+        static constexpr const char* LOG_PATH = ".mule/watch.log";
+
+        static int watch(const BuildOptions& options, const WatchOptions& watch_options);
+        // Stops a watcher started with --daemon.
+        static int stop();
+    };
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "ConfigParser.h"
+#include "PackageManager.h"
+#include <string>
+#include <vector>
+
+namespace mule {
+    // A root mule.toml whose [workspace] members lists package directories that build
+    // together: one scheduler run, one build/ directory and one mule.lock at the root. Path
+    // dependencies between members are edges of that build rather than links in .mule/deps.
+    //
+    //   [workspace]
+    //   members = ["core", "apps/*"]   # "dir/*" = every subdirectory of dir with a mule.toml
+    struct Workspace {
+        std::vector<MulePackage> members;     // Each after the members it depends on; path = member directory
+        std::vector<Dependency> dependencies; // What the members depend on outside the workspace, paths absolute
+
+        // Loads every member's mule.toml. Returns false if a member has no mule.toml, two
+        // members share a name, members depend on each other in a cycle, or two members
+        // declare one outside dependency with different sources.
+        static bool load(const Config& root, Workspace& out);
+    };
+}
@@ -0,0 +1,163 @@
+#include "../../include/core/Analyzer.h"
+#include "../../include/core/Json.h"
+#include "../../include/core/Toolchain.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    namespace {
+        struct SourceEvent {
+            std::string path;
+            double start = 0; // Microseconds, as in the trace
+            double end = 0;
+        };
+    }
+
+    static std::string read_file(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }
+
+    static void add_entry(std::map<std::string, TimeTraceSummary::Entry>& entries, const std::string& name, double ms) {
+        auto& entry = entries[name];
+        entry.total_ms += ms;
+        ++entry.count;
+    }
+
+    bool Analyzer::add_trace(const std::string& path, TimeTraceSummary& summary) {
+        JsonValue root;
+        if (!JsonValue::parse(read_file(path), root)) return false;
+        const JsonValue& events = root["traceEvents"];
+        if (events.type != JsonValue::Type::Array) return false;
+
+        std::vector<SourceEvent> sources;
+        for (const auto& event : events.array) {
+            if (event["ph"].string != "X") continue;
+            const std::string& name = event["name"].string;
+            const std::string& detail = event["args"]["detail"].string;
+            double start = event["ts"].number;
+            double dur = event["dur"].number;
+
+            if (name == "Source") {
+                sources.push_back({detail, start, start + dur});
+            } else if (name == "InstantiateClass" || name == "InstantiateFunction") {
+                add_entry(summary.instantiations, detail, dur / 1000.0);
+            } else if (name == "CodeGen Function") {
+                add_entry(summary.codegen, detail, dur / 1000.0);
+            } else if (name == "Frontend") {
+                summary.frontend_ms += dur / 1000.0;
+            } else if (name == "Backend") {
+                summary.backend_ms += dur / 1000.0;
+            }
+        }
+
+        // Source events nest the way the includes do. Walking them in start order with a
+        // stack of open headers gives each header the set of headers parsed inside it.
+        std::sort(sources.begin(), sources.end(), [](const SourceEvent& a, const SourceEvent& b) {
+            return a.start != b.start ? a.start < b.start : a.end > b.end;
+        });
+        std::map<std::string, std::set<std::string>> nested;
+        std::map<std::string, double> inclusive_ms;
+        std::vector<const SourceEvent*> open;
+        for (const auto& source : sources) {
+            while (!open.empty() && open.back()->end <= source.start) open.pop_back();
+            for (const auto* parent : open) {
+                if (parent->path != source.path) nested[parent->path].insert(source.path);
+            }
+            // Only the outermost occurrence counts, so recursive includes are not doubled
+            bool inside_itself = std::any_of(open.begin(), open.end(), [&](const SourceEvent* parent) { return parent->path == source.path; });
+            if (!inside_itself) inclusive_ms[source.path] += (source.end - source.start) / 1000.0;
+            open.push_back(&source);
+        }
+
+        for (const auto& [header, ms] : inclusive_ms) {
+            auto& entry = summary.headers[header];
+            entry.total_ms += ms;
+            ++entry.tus;
+            entry.fan_out = std::max(entry.fan_out, nested[header].size());
+        }
+        ++summary.units;
+        return true;
+    }
+
+    template <typename T, typename Key>
+    static std::vector<std::pair<std::string, T>> top_entries(const std::map<std::string, T>& entries, size_t top, Key key) {
+        std::vector<std::pair<std::string, T>> sorted(entries.begin(), entries.end());
+        std::sort(sorted.begin(), sorted.end(), [&](const auto& a, const auto& b) { return key(a.second) > key(b.second); });
+        if (sorted.size() > top) sorted.resize(top);
+        return sorted;
+    }
+
+    static std::string shorten(const std::string& name, size_t width = 100) {
+        if (name.size() <= width) return name;
+        return name.substr(0, width - 3) + "...";
+    }
+
+    void Analyzer::print_report(const TimeTraceSummary& summary, size_t top) {
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "\n\033[1;36mAnalyzed " << summary.units << " translation unit(s): frontend "
+                  << summary.frontend_ms << " ms, backend " << summary.backend_ms << " ms\033[0m\n";
+
+        std::cout << "\n\033[1mHeaders by total parse time\033[0m (inclusive; TUs = translation units including it, fan-out = headers it pulls in)\n";
+        std::cout << std::setw(12) << "total ms" << std::setw(10) << "avg ms" << std::setw(6) << "TUs" << std::setw(9) << "fan-out" << "  header\n";
+        for (const auto& [header, entry] : top_entries(summary.headers, top, [](const TimeTraceSummary::Header& h) { return h.total_ms; })) {
+            std::cout << std::setw(12) << entry.total_ms << std::setw(10) << entry.total_ms / entry.tus << std::setw(6) << entry.tus
+                      << std::setw(9) << entry.fan_out << "  " << header << "\n";
+        }
+
+        std::cout << "\n\033[1mTemplate instantiations by total time\033[0m\n";
+        std::cout << std::setw(12) << "total ms" << std::setw(8) << "count" << "  template\n";
+        for (const auto& [name, entry] : top_entries(summary.instantiations, top, [](const TimeTraceSummary::Entry& e) { return e.total_ms; })) {
+            std::cout << std::setw(12) << entry.total_ms << std::setw(8) << entry.count << "  " << shorten(name) << "\n";
+        }
+
+        std::cout << "\n\033[1mCode generation by function\033[0m\n";
+        std::cout << std::setw(12) << "total ms" << std::setw(8) << "count" << "  function\n";
+        for (const auto& [name, entry] : top_entries(summary.codegen, top, [](const TimeTraceSummary::Entry& e) { return e.total_ms; })) {
+            std::cout << std::setw(12) << entry.total_ms << std::setw(8) << entry.count << "  " << shorten(name) << "\n";
+        }
+        std::cout << "\nHeaders parsed by many TUs are candidates for [build] pch; expensive headers with few uses\n"
+                  << "are candidates for forward declarations." << std::endl;
+    }
+
+    int Analyzer::analyze_headers(const Config& config, const BuildOptions& options, size_t top) {
+        ToolchainInfo toolchain;
+        if (!Toolchain::detect(toolchain) || toolchain.type != CompilerType::Clang) {
+            std::cerr << "Error: mule analyze headers needs clang++ in PATH (it relies on -ftime-trace)." << std::endl;
+            return 1;
+        }
+
+        // Every TU has to be compiled for real to produce a trace, up to date or not
+        BuildOptions trace_options = options;
+        trace_options.use_cache = false;
+        trace_options.time_trace = true;
+        trace_options.rebuild = true;
+        auto started = fs::file_time_type::clock::now();
+        if (!Builder::build(config, trace_options)) return 1;
+
+        // clang writes the trace next to the object, e.g. build/main.o -> build/main.json
+        TimeTraceSummary summary;
+        for (const auto& entry : fs::directory_iterator("build")) {
+            if (entry.path().extension() != ".json" || entry.last_write_time() < started) continue;
+            if (!add_trace(entry.path().string(), summary)) {
+                std::cerr << "Warning: could not read time trace " << entry.path().string() << std::endl;
+            }
+        }
+        if (summary.units == 0) {
+            std::cerr << "Error: no time traces were produced in build/." << std::endl;
+            return 1;
+        }
+        print_report(summary, top);
+        return 0;
+    }
+}
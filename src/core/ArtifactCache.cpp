@@ -0,0 +1,134 @@
+#include "../../include/core/ArtifactCache.h"
+#include "../../include/core/CompileCache.h"
+#include "../../include/core/Utils.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    // Entry layout:
+    //   <key>/prefix   absolute install prefix the files were installed for
+    //   <key>/tree/    the installed files
+    static const char* FORMAT = "artifact-v1";
+
+    static fs::path local_dir() {
+        return fs::path(CompileCache::cache_dir()) / "artifacts";
+    }
+
+    // The local cache first, then $MULE_ARTIFACT_PATH in order.
+    static std::vector<fs::path> search_dirs() {
+        std::vector<fs::path> dirs = {local_dir()};
+#ifdef _WIN32
+        const char separator = ';';
+#else
+        const char separator = ':';
+#endif
+        if (const char* env = std::getenv("MULE_ARTIFACT_PATH")) {
+            std::stringstream ss(env);
+            std::string dir;
+            while (std::getline(ss, dir, separator)) {
+                if (!dir.empty()) dirs.push_back(dir);
+            }
+        }
+        return dirs;
+    }
+
+    std::string ArtifactCache::key(const Dependency& dep, const std::string& toolchain_identity,
+                                   const std::string& standard, const std::string& build_type) {
+        uint64_t key = hash_string(FORMAT);
+        key = hash_string(dep.commit, key);
+        key = hash_string(dep.subdir, key);
+        key = hash_string(toolchain_identity, key);
+        key = hash_string(standard, key);
+        key = hash_string(build_type, key);
+        return to_hex(key);
+    }
+
+    // Files that name the install prefix in plain text and must follow it to its new place
+    static bool is_relocatable_text(const fs::path& path) {
+        std::string ext = path.extension().string();
+        return ext == ".pc" || ext == ".cmake" || ext == ".la";
+    }
+
+    static bool read_file(const fs::path& path, std::string& out) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        std::stringstream ss;
+        ss << in.rdbuf();
+        out = ss.str();
+        return true;
+    }
+
+    bool ArtifactCache::restore(const std::string& key, const std::string& prefix) {
+        for (const auto& dir : search_dirs()) {
+            fs::path entry = dir / key;
+            std::string old_prefix;
+            if (!fs::is_directory(entry / "tree") || !read_file(entry / "prefix", old_prefix)) continue;
+            while (!old_prefix.empty() && (old_prefix.back() == '\n' || old_prefix.back() == '\r')) old_prefix.pop_back();
+
+            std::error_code ec;
+            fs::path tree = entry / "tree";
+            bool ok = true;
+            for (auto it = fs::recursive_directory_iterator(tree, ec); ok && !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                fs::path dest = fs::path(prefix) / fs::relative(it->path(), tree);
+                if (it->is_symlink(ec)) {
+                    fs::copy_symlink(it->path(), dest, ec);
+                } else if (it->is_directory(ec)) {
+                    fs::create_directories(dest, ec);
+                } else if (is_relocatable_text(it->path())) {
+                    std::string content;
+                    ok = read_file(it->path(), content);
+                    for (size_t pos = 0; !old_prefix.empty() && (pos = content.find(old_prefix, pos)) != std::string::npos; pos += prefix.size()) {
+                        content.replace(pos, old_prefix.size(), prefix);
+                    }
+                    std::ofstream out(dest, std::ios::binary | std::ios::trunc);
+                    ok = ok && (out << content);
+                } else {
+                    fs::create_hard_link(it->path(), dest, ec);
+                    if (ec) fs::copy_file(it->path(), dest, fs::copy_options::overwrite_existing, ec);
+                }
+                ok = ok && !ec;
+            }
+            if (ok && !ec) {
+                // Keeps the entry from being evicted as least recently used
+                if (dir == local_dir()) fs::last_write_time(entry / "prefix", fs::file_time_type::clock::now(), ec);
+                return true;
+            }
+
+            // A damaged entry: leave an empty prefix behind and try the next directory
+            fs::remove_all(prefix, ec);
+            fs::create_directories(prefix, ec);
+        }
+        return false;
+    }
+
+    void ArtifactCache::store(const std::string& key, const std::string& prefix) {
+        fs::path entry = local_dir() / key;
+        std::error_code ec;
+        if (fs::exists(entry) || !fs::is_directory(prefix) || fs::is_empty(prefix, ec)) return;
+
+        fs::path tmp = local_dir() / (key + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        fs::create_directories(tmp, ec);
+        fs::copy(prefix, tmp / "tree", fs::copy_options::recursive | fs::copy_options::copy_symlinks, ec);
+        if (!ec) {
+            std::ofstream out(tmp / "prefix", std::ios::trunc);
+            out << prefix << "\n";
+            if (!out) ec = std::make_error_code(std::errc::io_error);
+        }
+        uint64_t size = 0;
+        for (auto it = fs::recursive_directory_iterator(tmp, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && !it->is_symlink(ec)) size += it->file_size(ec);
+        }
+        if (!ec) fs::rename(tmp, entry, ec);
+        if (ec) {
+            fs::remove_all(tmp, ec); // Another build stored it first, or the copy failed
+            return;
+        }
+        CompileCache::add_size(size);
+    }
+}
@@ -0,0 +1,307 @@
+#include "../../include/core/BuildDb.h"
+#include "../../include/core/Utils.h"
+#include <fstream>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    // File layout (little-endian host order):
+    //   "MULEDB" u32 version
+    //   u32 file_count   { str path, i64 mtime, u64 size, u64 hash }
+    //   u32 output_count { str path, u64 command_hash, u64 input_hash, f64 wall_ms, i64 peak_rss_kb,
+    //                      u32 n, u32 file_index * n }
+    // where str is a u32 length followed by the bytes. Inputs refer to the file table by
+    // index so shared headers are only stored once.
+    static const char DB_MAGIC[6] = {'M', 'U', 'L', 'E', 'D', 'B'};
+    static const uint32_t DB_VERSION = 2;
+
+    template <typename T>
+    static void write_pod(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static bool read_pod(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    static void write_str(std::ostream& out, const std::string& str) {
+        write_pod(out, static_cast<uint32_t>(str.size()));
+        out.write(str.data(), str.size());
+    }
+
+    static bool read_str(std::istream& in, std::string& str) {
+        uint32_t len;
+        if (!read_pod(in, len)) return false;
+        str.resize(len);
+        return static_cast<bool>(in.read(&str[0], len));
+    }
+
+    bool BuildDb::load(const std::string& path) {
+        files_.clear();
+        outputs_.clear();
+        verified_.clear();
+        dirty_ = false;
+
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+
+        char magic[6];
+        uint32_t version;
+        if (!in.read(magic, sizeof magic) || std::string(magic, 6) != std::string(DB_MAGIC, 6)) return false;
+        if (!read_pod(in, version) || version != DB_VERSION) return false;
+
+        uint32_t file_count;
+        if (!read_pod(in, file_count)) return false;
+        std::vector<std::string> file_paths(file_count);
+        for (uint32_t i = 0; i < file_count; ++i) {
+            FileEntry entry;
+            if (!read_str(in, file_paths[i]) || !read_pod(in, entry.mtime) ||
+                !read_pod(in, entry.size) || !read_pod(in, entry.hash)) {
+                files_.clear();
+                return false;
+            }
+            files_[file_paths[i]] = entry;
+        }
+
+        uint32_t output_count;
+        if (!read_pod(in, output_count)) return false;
+        for (uint32_t i = 0; i < output_count; ++i) {
+            std::string output;
+            OutputEntry entry;
+            uint32_t n;
+            if (!read_str(in, output) || !read_pod(in, entry.command_hash) ||
+                !read_pod(in, entry.input_hash) || !read_pod(in, entry.wall_ms) ||
+                !read_pod(in, entry.peak_rss_kb) || !read_pod(in, n)) {
+                outputs_.clear();
+                return false;
+            }
+            entry.inputs.reserve(n);
+            for (uint32_t j = 0; j < n; ++j) {
+                uint32_t index;
+                if (!read_pod(in, index) || index >= file_paths.size()) {
+                    outputs_.clear();
+                    return false;
+                }
+                entry.inputs.push_back(file_paths[index]);
+            }
+            outputs_[output] = std::move(entry);
+        }
+        return true;
+    }
+
+    bool BuildDb::save(const std::string& path) {
+        if (!dirty_) return true;
+
+        fs::path db_path = path;
+        if (db_path.has_parent_path()) fs::create_directories(db_path.parent_path());
+        std::string tmp_path = path + ".tmp";
+
+        {
+            std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+
+            out.write(DB_MAGIC, sizeof DB_MAGIC);
+            write_pod(out, DB_VERSION);
+
+            // Only files that some output still depends on are kept
+            std::unordered_map<std::string, uint32_t> index;
+            std::vector<const std::string*> referenced;
+            for (const auto& [output, entry] : outputs_) {
+                for (const auto& input : entry.inputs) {
+                    if (index.emplace(input, static_cast<uint32_t>(referenced.size())).second) {
+                        referenced.push_back(&input);
+                    }
+                }
+            }
+
+            write_pod(out, static_cast<uint32_t>(referenced.size()));
+            for (const auto* file : referenced) {
+                const FileEntry& entry = files_.at(*file);
+                write_str(out, *file);
+                write_pod(out, entry.mtime);
+                write_pod(out, entry.size);
+                write_pod(out, entry.hash);
+            }
+
+            write_pod(out, static_cast<uint32_t>(outputs_.size()));
+            for (const auto& [output, entry] : outputs_) {
+                write_str(out, output);
+                write_pod(out, entry.command_hash);
+                write_pod(out, entry.input_hash);
+                write_pod(out, entry.wall_ms);
+                write_pod(out, entry.peak_rss_kb);
+                write_pod(out, static_cast<uint32_t>(entry.inputs.size()));
+                for (const auto& input : entry.inputs) write_pod(out, index.at(input));
+            }
+            if (!out) return false;
+        }
+
+        std::error_code ec;
+        fs::rename(tmp_path, path, ec);
+        if (ec) return false;
+        dirty_ = false;
+        return true;
+    }
+
+    bool BuildDb::file_hash(const std::string& path, uint64_t& out_hash) {
+        if (verified_.count(path)) {
+            out_hash = files_.at(path).hash;
+            return true;
+        }
+
+        std::error_code ec;
+        auto mtime = fs::last_write_time(path, ec);
+        if (ec) return false;
+        uint64_t size = fs::file_size(path, ec);
+        if (ec) return false;
+
+        int64_t mtime_ticks = static_cast<int64_t>(mtime.time_since_epoch().count());
+        auto it = files_.find(path);
+        if (it != files_.end() && it->second.mtime == mtime_ticks && it->second.size == size) {
+            out_hash = it->second.hash;
+            if (is_trusted(path)) verified_.insert(path);
+            return true;
+        }
+
+        FileEntry entry;
+        if (!hash_file(path, entry.hash)) return false;
+        entry.mtime = mtime_ticks;
+        entry.size = size;
+        files_[path] = entry;
+        if (is_trusted(path)) verified_.insert(path);
+        dirty_ = true;
+        out_hash = entry.hash;
+        return true;
+    }
+
+    void BuildDb::set_trusted_roots(const std::vector<std::string>& roots) {
+        trusted_roots_.clear();
+        for (const auto& root : roots) trusted_roots_.push_back(fs::path(root).lexically_normal().generic_string());
+        verified_.clear();
+    }
+
+    bool BuildDb::is_trusted(const std::string& path) const {
+        if (trusted_roots_.empty()) return false;
+        std::string normal = fs::path(path).lexically_normal().generic_string();
+        for (const auto& root : trusted_roots_) {
+            if (normal == root || (normal.compare(0, root.size(), root) == 0 && normal[root.size()] == '/')) return true;
+        }
+        return false;
+    }
+
+    void BuildDb::invalidate(const std::string& path) {
+        // Depfiles may spell the same file differently (e.g. "src/../include/a.h")
+        fs::path changed = fs::path(path).lexically_normal();
+        for (auto it = verified_.begin(); it != verified_.end();) {
+            if (fs::path(*it).lexically_normal() == changed) {
+                it = verified_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    bool BuildDb::inputs_hash(const std::vector<std::string>& inputs, uint64_t& out_hash) {
+        uint64_t combined = hash_string("");
+        for (const auto& input : inputs) {
+            uint64_t h;
+            if (!file_hash(input, h)) return false;
+            combined = hash_string(input, combined);
+            combined = hash_string(std::string(reinterpret_cast<const char*>(&h), sizeof h), combined);
+        }
+        out_hash = combined;
+        return true;
+    }
+
+    bool BuildDb::is_up_to_date(const std::string& output, const std::string& command) {
+        auto it = outputs_.find(output);
+        if (it == outputs_.end() || !fs::exists(output)) return false;
+        if (it->second.command_hash != hash_string(command)) return false;
+
+        uint64_t current;
+        if (!inputs_hash(it->second.inputs, current)) return false;
+        return current == it->second.input_hash;
+    }
+
+    std::vector<std::string> BuildDb::inputs_of(const std::string& output) const {
+        auto it = outputs_.find(output);
+        if (it == outputs_.end()) return {};
+        return it->second.inputs;
+    }
+
+    static bool stat_file(const std::string& path, int64_t& mtime, uint64_t& size) {
+        std::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (ec) return false;
+        size = fs::file_size(path, ec);
+        if (ec) return false;
+        mtime = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    InputSnapshot BuildDb::snapshot(const std::string& output, const std::vector<std::string>& paths,
+                                    const std::vector<std::string>& unchecked) const {
+        InputSnapshot snapshot;
+        snapshot.unchecked.insert(unchecked.begin(), unchecked.end());
+        snapshot.taken = static_cast<int64_t>(fs::file_time_type::clock::now().time_since_epoch().count());
+        std::vector<std::string> all = paths;
+        auto it = outputs_.find(output);
+        if (it != outputs_.end()) all.insert(all.end(), it->second.inputs.begin(), it->second.inputs.end());
+        for (const auto& path : all) {
+            int64_t mtime;
+            uint64_t size;
+            if (!path.empty() && !snapshot.unchecked.count(path) && stat_file(path, mtime, size)) snapshot.files[path] = {mtime, size};
+        }
+        return snapshot;
+    }
+
+    bool BuildDb::record(const std::string& output, const std::string& command, const std::vector<std::string>& inputs,
+                         const InputSnapshot& before) {
+        OutputEntry entry;
+        entry.command_hash = hash_string(command);
+        entry.inputs = inputs;
+        bool changed = false;
+        for (size_t i = 0; before.taken != 0 && !changed && i < inputs.size(); ++i) {
+            int64_t mtime;
+            uint64_t size;
+            if (before.unchecked.count(inputs[i])) continue;
+            if (!stat_file(inputs[i], mtime, size)) break; // Caught by inputs_hash below
+            auto it = before.files.find(inputs[i]);
+            changed = it != before.files.end() ? it->second != std::make_pair(mtime, size) : mtime > before.taken;
+        }
+        if (changed || !inputs_hash(inputs, entry.input_hash)) {
+            // An input was saved or vanished while building; forget the output so it is
+            // rebuilt next time
+            outputs_.erase(output);
+            dirty_ = true;
+            return false;
+        }
+        auto previous = outputs_.find(output);
+        if (previous != outputs_.end()) {
+            entry.wall_ms = previous->second.wall_ms;
+            entry.peak_rss_kb = previous->second.peak_rss_kb;
+        }
+        outputs_[output] = std::move(entry);
+        dirty_ = true;
+        return true;
+    }
+
+    void BuildDb::record_cost(const std::string& output, double wall_ms, long peak_rss_kb) {
+        auto it = outputs_.find(output);
+        if (it == outputs_.end()) return;
+        it->second.wall_ms = wall_ms;
+        it->second.peak_rss_kb = peak_rss_kb;
+        dirty_ = true;
+    }
+
+    bool BuildDb::cost_of(const std::string& output, double& wall_ms, long& peak_rss_kb) const {
+        auto it = outputs_.find(output);
+        if (it == outputs_.end() || it->second.wall_ms <= 0) return false;
+        wall_ms = it->second.wall_ms;
+        peak_rss_kb = static_cast<long>(it->second.peak_rss_kb);
+        return true;
+    }
+}
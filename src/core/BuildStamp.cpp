@@ -0,0 +1,111 @@
+#include "../../include/core/BuildStamp.h"
+#include "../../include/core/Toolchain.h"
+#include "../../include/core/Utils.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    static std::string read_file(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }
+
+    // Everything that is read whole rather than stat'ed: the config, the lockfile, the
+    // toolchain fingerprint and the options that change what gets built.
+    static std::string stamp_key(const BuildOptions& options) {
+        uint64_t key = hash_string(VERSION);
+        key = hash_string(read_file("mule.toml"), key);
+        key = hash_string(read_file("mule.lock"), key);
+        key = hash_string(read_file(Toolchain::CACHE_PATH), key);
+        // The cached fingerprint is of the last compiler used; a different one now first in
+        // PATH, or the same one upgraded, must not look up to date
+        ToolchainInfo toolchain;
+        if (Toolchain::locate(toolchain)) {
+            key = hash_string(toolchain.path + "\n" + std::to_string(toolchain.mtime), key);
+        }
+        key = hash_string(options.unity ? "unity" : "", key);
+        key = hash_string(options.time_trace ? "time-trace" : "", key);
+        key = hash_string(options.release ? "release" : "dev", key);
+        return to_hex(key);
+    }
+
+    static bool stat_file(const std::string& path, int64_t& mtime, uint64_t& size) {
+        std::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (ec) return false;
+        size = fs::is_directory(path, ec) ? 0 : fs::file_size(path, ec);
+        if (ec) return false;
+        mtime = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    // Text format:
+    //   key <hex>
+    //   target <path>
+    //   <mtime> <size> <path>   (one line per file or directory)
+    bool BuildStamp::is_current(const BuildOptions& options, std::string& target) {
+        std::ifstream in(PATH);
+        if (!in) return false;
+
+        std::string line;
+        if (!std::getline(in, line) || line != "key " + stamp_key(options)) return false;
+        if (!std::getline(in, line) || line.rfind("target ", 0) != 0) return false;
+        target = line.substr(7);
+
+        while (std::getline(in, line)) {
+            std::istringstream entry(line);
+            int64_t mtime;
+            uint64_t size;
+            if (!(entry >> mtime >> size)) return false;
+            entry.get(); // Separator before the path, which may contain spaces
+            std::string path;
+            std::getline(entry, path);
+
+            int64_t current_mtime;
+            uint64_t current_size;
+            if (!stat_file(path, current_mtime, current_size) || current_mtime != mtime || current_size != size) return false;
+        }
+        return true;
+    }
+
+    void BuildStamp::write(const BuildOptions& options, const std::string& target,
+                           const std::vector<std::string>& files, const std::vector<std::string>& dirs) {
+        fs::create_directories(fs::path(PATH).parent_path());
+        std::string tmp_path = std::string(PATH) + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::trunc);
+            out << "key " << stamp_key(options) << "\n" << "target " << target << "\n";
+
+            std::set<std::string> seen;
+            for (const auto* list : {&files, &dirs}) {
+                for (const auto& path : *list) {
+                    if (!seen.insert(path).second) continue;
+                    int64_t mtime;
+                    uint64_t size;
+                    if (!stat_file(path, mtime, size)) {
+                        // Cannot prove anything about a file that is gone
+                        out.close();
+                        fs::remove(tmp_path);
+                        return;
+                    }
+                    out << mtime << " " << size << " " << path << "\n";
+                }
+            }
+            if (!out) return;
+        }
+        std::error_code ec;
+        fs::rename(tmp_path, PATH, ec);
+    }
+
+    void BuildStamp::invalidate() {
+        std::error_code ec;
+        fs::remove(PATH, ec);
+    }
+}
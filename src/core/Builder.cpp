@@ -1,15 +1,175 @@
 #include "../../include/core/Builder.h"
 #include "../../include/core/Utils.h"
 #include "../../include/core/PackageManager.h"
+#include "../../include/core/JobScheduler.h"
+#include "../../include/core/Jobserver.h"
+#include "../../include/core/DepTracker.h"
+#include "../../include/core/BuildDb.h"
+#include "../../include/core/CompileCache.h"
+#include "../../include/core/UnityBuild.h"
+#include "../../include/core/ModuleScanner.h"
+#include "../../include/core/Process.h"
+#include "../../include/core/Toolchain.h"
+#include "../../include/core/BuildStamp.h"
+#include "../../include/core/Timings.h"
+#include "../../include/core/Workspace.h"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <cstdlib>
+#include <optional>
+#include <map>
+#include <set>
+#include <iomanip>
+#include <algorithm>
 
 namespace fs = std::filesystem;
 
 namespace mule {
 
+    // What a scheduled job produces, so the build database and compile cache can be
+    // updated once it has finished.
+    struct JobOutput {
+        std::string path;       // For dependency builds, a key to remember their cost under
+        std::string depfile;    // Empty for the link step
+        std::string source;
+        bool cacheable = false;
+        std::vector<std::string> extra_inputs; // Dependencies the depfile does not list; all inputs of links and archives
+        // CMake/Make build of a dependency. Recorded in the build db under the synthetic path
+        // "dependency: <description>" like any other job, though only its cost is read back.
+        bool dependency = false;
+        InputSnapshot before; // Inputs as they were when the job was queued
+    };
+
+    static std::vector<std::string> depfile_inputs(const JobOutput& out) {
+        std::vector<std::string> inputs = DepTracker::parse_depfile(out.depfile);
+        inputs.insert(inputs.end(), out.extra_inputs.begin(), out.extra_inputs.end());
+        return inputs;
+    }
+
+    // Sets every job's estimated duration and memory from its last measured run. Compiles
+    // that were never measured are assumed to take time in proportion to their source size,
+    // at the rate the measured compiles of this build ran at (or a rough default without any
+    // history), and as much memory as the measured ones did on average.
+    static void estimate_costs(const BuildDb& db, std::vector<Job>& jobs, const std::vector<JobOutput>& outputs) {
+        const double DEFAULT_MS_PER_KB = 50.0;
+        const double DEFAULT_MIN_COMPILE_MS = 200.0; // Even a tiny TU pays for its headers
+        const double LINK_MS_PER_INPUT = 5.0;
+        const long DEFAULT_MEMORY_KB = 512 * 1024;
+        const double DEPENDENCY_BUILD_MS = 10000.0; // Whole external builds; start them early
+
+        std::vector<double> source_kb(jobs.size(), 0);
+        std::vector<bool> measured(jobs.size(), false);
+        double measured_ms = 0, measured_kb = 0;
+        long measured_memory_kb = 0, measured_count = 0;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            measured[i] = db.cost_of(outputs[i].path, jobs[i].estimate_ms, jobs[i].memory_kb);
+            if (measured[i]) {
+                measured_memory_kb += jobs[i].memory_kb;
+                ++measured_count;
+            }
+            if (outputs[i].source.empty()) continue;
+            std::error_code ec;
+            auto size = fs::file_size(outputs[i].source, ec);
+            if (!ec) source_kb[i] = static_cast<double>(size) / 1024.0;
+            if (measured[i] && source_kb[i] > 0) {
+                measured_ms += jobs[i].estimate_ms;
+                measured_kb += source_kb[i];
+            }
+        }
+
+        bool calibrated = measured_kb > 0;
+        double ms_per_kb = calibrated ? measured_ms / measured_kb : DEFAULT_MS_PER_KB;
+        long memory_kb = measured_count > 0 ? measured_memory_kb / measured_count : DEFAULT_MEMORY_KB;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (measured[i]) continue;
+            jobs[i].memory_kb = memory_kb;
+            if (outputs[i].dependency) {
+                jobs[i].estimate_ms = DEPENDENCY_BUILD_MS;
+            } else if (outputs[i].source.empty()) {
+                jobs[i].estimate_ms = LINK_MS_PER_INPUT * static_cast<double>(jobs[i].deps.size() + 1);
+            } else {
+                jobs[i].estimate_ms = std::max(calibrated ? 1.0 : DEFAULT_MIN_COMPILE_MS, source_kb[i] * ms_per_kb);
+            }
+        }
+    }
+
+    // The jobs of one scheduler run, and the build database and compile cache that decide
+    // which steps have to run at all.
+    struct JobQueue {
+        BuildDb& db;
+        CompileCache* cache = nullptr;
+        std::vector<Job> jobs;
+        std::vector<JobOutput> outputs; // Parallel to jobs
+        std::vector<size_t> installs;   // CMake dependency installs every queued compile waits for
+
+        // Queues job unless its output is up to date or the compile cache has it. Returns
+        // true if the job was queued.
+        bool queue(const Job& job, const JobOutput& out, bool force = false) {
+            if (!force && db.is_up_to_date(out.path, job.command)) return false;
+            if (!force && cache && out.cacheable && cache->fetch(db, job.command, out.source, out.path, out.depfile)) {
+                std::cout << job.description << " (cached)" << std::endl;
+                db.record(out.path, job.command, depfile_inputs(out));
+                return false;
+            }
+            jobs.push_back(job);
+            jobs.back().deps.insert(jobs.back().deps.end(), installs.begin(), installs.end());
+            outputs.push_back(out);
+            outputs.back().before = db.snapshot(out.path, {out.source}, out.extra_inputs);
+            return true;
+        }
+    };
+
+    // Runs jobs with the scheduler, reports the makespan and records what the jobs that
+    // succeeded produced in the build database and compile cache.
+    static bool run_jobs(JobQueue& queue, const BuildOptions& options) {
+        std::vector<Job>& jobs = queue.jobs;
+        const std::vector<JobOutput>& job_outputs = queue.outputs;
+        BuildDb& db = queue.db;
+        CompileCache* cache = queue.cache;
+        estimate_costs(db, jobs, job_outputs);
+        long memory_budget_kb = options.mem_limit_kb > 0 ? options.mem_limit_kb : JobScheduler::default_memory_budget_kb();
+        double predicted_ms = JobScheduler::predict_makespan(jobs, options.jobs, memory_budget_kb);
+        double discovery_order_ms = JobScheduler::predict_makespan(jobs, options.jobs, memory_budget_kb, false);
+
+        double run_start = Timings::now_ms();
+        bool ok = JobScheduler::run(jobs, options.jobs, memory_budget_kb);
+        double actual_ms = Timings::now_ms() - run_start;
+        if (ok && jobs.size() > 2) {
+            std::cout << std::fixed << std::setprecision(2) << "Makespan: predicted " << predicted_ms / 1000.0 << " s ("
+                      << discovery_order_ms / 1000.0 << " s in discovery order), actual " << actual_ms / 1000.0 << " s";
+            if (memory_budget_kb > 0) std::cout << ", memory budget " << memory_budget_kb / (1024.0 * 1024.0) << " GiB";
+            std::cout << std::defaultfloat << std::endl;
+        }
+
+        if (Timings::enabled()) {
+            std::vector<size_t> event_ids(jobs.size());
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                if (jobs[i].status == JobStatus::Skipped) continue;
+                std::string category = job_outputs[i].dependency ? "dependency" : job_outputs[i].depfile.empty() ? "link" : "compile";
+                TimingEvent event{jobs[i].description, category, jobs[i].slot,
+                                  run_start + jobs[i].start_ms, jobs[i].wall_ms, jobs[i].cpu_ms, jobs[i].peak_rss_kb, {}};
+                for (size_t dep : jobs[i].deps) event.deps.push_back(event_ids[dep]);
+                event_ids[i] = Timings::record(event);
+            }
+        }
+
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (jobs[i].status != JobStatus::Succeeded) continue;
+            const JobOutput& out = job_outputs[i];
+            if (out.depfile.empty()) {
+                db.record(out.path, jobs[i].command, out.extra_inputs, out.before);
+                db.record_cost(out.path, jobs[i].wall_ms, jobs[i].peak_rss_kb);
+                continue;
+            }
+            bool recorded = db.record(out.path, jobs[i].command, depfile_inputs(out), out.before);
+            db.record_cost(out.path, jobs[i].wall_ms, jobs[i].peak_rss_kb);
+            // An object built from content that has since changed must not be published
+            if (recorded && cache && out.cacheable) cache->store(db, jobs[i].command, out.source, out.path, out.depfile, out.extra_inputs);
+        }
+        return ok;
+    }
+
     // Helper functions (internal linkage)
     static std::string get_obj_extension(CompilerType type) {
         return (type == CompilerType::MSVC) ? ".obj" : ".o";
@@ -36,37 +196,47 @@ namespace mule {
         return get_exe_extension();
     }
 
-    static std::string make_compile_cmd(CompilerType type, const std::string& compiler, const std::string& src, const std::string& obj, const std::string& std_ver, const std::string& flags, bool is_shared) {
+    static std::string get_target_path(CompilerType type, const std::string& target_type, const std::string& bin_name) {
+        std::string ext = get_lib_extension(target_type);
+        std::string prefix = (target_type != "bin" && type != CompilerType::MSVC) ? "lib" : "";
+        return "build/" + prefix + bin_name + ext;
+    }
+
+    // Keeps absolute checkout paths out of objects so cached ones are reusable anywhere.
+    static std::string prefix_map_flag(CompilerType type) {
+        if (type == CompilerType::MSVC) return "";
+        return Process::quote("-ffile-prefix-map=" + fs::current_path().string() + "=.") + " ";
+    }
+
+    // lang overrides how the compiler treats src (e.g. "-x c++-module "), it goes right before it.
+    static std::string make_compile_cmd(CompilerType type, const std::string& compiler, const std::string& src, const std::string& obj, const std::string& std_ver, const std::string& flags, bool is_shared, const std::string& lang = "") {
         std::string pic = "";
         if (is_shared && type != CompilerType::MSVC) pic = "-fPIC ";
+        std::string deps = DepTracker::depfile_flags(DepTracker::depfile_path(obj, type), type);
 
         if (type == CompilerType::MSVC) {
-            return compiler + " /std:c++" + std_ver + " /c " + src + " /Fo" + obj + " /EHsc " + flags;
+            return compiler + " /std:c++" + std_ver + " /c " + lang + Process::quote(src) + " " + Process::quote("/Fo" + obj) + " /EHsc " + deps + flags;
         } else {
-            return compiler + " -std=c++" + std_ver + " " + pic + "-c " + src + " -o " + obj + " " + flags;
+            return compiler + " -std=c++" + std_ver + " " + pic + prefix_map_flag(type) + deps + "-c " + lang + Process::quote(src) + " -o " + Process::quote(obj) + " " + flags;
         }
     }
 
-    static std::string make_link_cmd(CompilerType type, const std::string& compiler, const std::vector<std::string>& objs, const std::string& bin_name, const Config& config) {
+    static std::string make_link_cmd(CompilerType type, const std::string& compiler, const std::vector<std::string>& objs, const std::string& output, const Config& config) {
         std::string cmd = compiler + " ";
         if (config.type == "shared-lib" && type != CompilerType::MSVC) cmd += "-shared ";
         
-        for (const auto& obj : objs) cmd += obj + " ";
-        
-        std::string ext = get_lib_extension(config.type);
-        std::string prefix = (config.type != "bin" && type != CompilerType::MSVC) ? "lib" : "";
-        std::string output = "build/" + prefix + bin_name + ext;
+        for (const auto& obj : objs) cmd += Process::quote(obj) + " ";
 
         if (type == CompilerType::MSVC) {
             if (config.type == "shared-lib") cmd += "/LD ";
-            cmd += "/Fe" + output + " ";
+            cmd += Process::quote("/Fe" + output) + " ";
         } else {
-            cmd += "-o " + output + " ";
+            cmd += "-o " + Process::quote(output) + " ";
         }
 
         // Add build flags
         for (const auto& dir : config.build.lib_dirs) {
-            cmd += (type == CompilerType::MSVC ? "/LIBPATH:" : "-L") + dir + " ";
+            cmd += Process::quote((type == CompilerType::MSVC ? "/LIBPATH:" : "-L") + dir) + " ";
         }
         for (const auto& lib : config.build.libs) {
             cmd += (type == CompilerType::MSVC ? "" : "-l") + lib + (type == CompilerType::MSVC ? ".lib " : " ");
@@ -90,18 +260,14 @@ namespace mule {
         return cmd;
     }
 
-    static std::string make_archive_cmd(CompilerType type, const std::vector<std::string>& objs, const std::string& bin_name) {
-        std::string ext = get_lib_extension("static-lib");
-        std::string prefix = (type != CompilerType::MSVC) ? "lib" : "";
-        std::string output = "build/" + prefix + bin_name + ext;
-
+    static std::string make_archive_cmd(CompilerType type, const std::vector<std::string>& objs, const std::string& output) {
         if (type == CompilerType::MSVC) {
-            std::string cmd = "lib /OUT:" + output + " ";
-            for (const auto& obj : objs) cmd += obj + " ";
+            std::string cmd = "lib " + Process::quote("/OUT:" + output) + " ";
+            for (const auto& obj : objs) cmd += Process::quote(obj) + " ";
             return cmd;
         } else {
-            std::string cmd = "ar rcs " + output + " ";
-            for (const auto& obj : objs) cmd += obj + " ";
+            std::string cmd = "ar rcs " + Process::quote(output) + " ";
+            for (const auto& obj : objs) cmd += Process::quote(obj) + " ";
             return cmd;
         }
     }
@@ -126,48 +292,410 @@ namespace mule {
         return false;
     }
 
-    CompilerType Builder::detect_compiler(std::string& out_cmd) {
-        if (command_exists("clang++")) {
-            out_cmd = "clang++";
-            return CompilerType::Clang;
+    static std::string bmi_extension(CompilerType type) {
+        if (type == CompilerType::MSVC) return ".ifc";
+        if (type == CompilerType::Clang) return ".pcm";
+        return ".gcm";
+    }
+
+    // File name the compilers expect for a module BMI: partitions use '-' instead of ':'.
+    static std::string bmi_path(const fs::path& dir, const std::string& module, CompilerType type) {
+        return (dir / (replace_all(module, ":", "-") + bmi_extension(type))).string();
+    }
+
+    // Flags that let a TU find the BMIs of the modules it imports.
+    static std::string module_search_flags(CompilerType type, const fs::path& dir) {
+        if (type == CompilerType::MSVC) return "/ifcSearchDir " + dir.string() + " ";
+        if (type == CompilerType::Clang) return "-fprebuilt-module-path=" + dir.string() + " ";
+        return "-fmodules-ts -fmodule-mapper=" + (dir / "mapper.txt").string() + " ";
+    }
+
+    // Extra flags and language override for a TU that provides a module interface.
+    static std::string module_interface_flags(CompilerType type, const std::string& bmi) {
+        if (type == CompilerType::MSVC) return "/interface /ifcOutput " + bmi + " ";
+        if (type == CompilerType::Clang) return "-fmodule-output=" + bmi + " ";
+        return ""; // GCC writes the BMI named in the module mapper
+    }
+
+    static std::string module_lang(CompilerType type, const std::string& src, bool is_interface) {
+        if (type == CompilerType::MSVC) return "/TP ";
+        if (type == CompilerType::Clang && is_interface) return "-x c++-module ";
+        if (ModuleScanner::is_interface_extension(src)) return "-x c++ ";
+        return "";
+    }
+
+    // Orders module TUs so every interface is compiled before its importers. Returns false
+    // on an import cycle.
+    static bool sort_module_units(const std::vector<std::string>& units, const std::map<std::string, ModuleInfo>& infos,
+                                  const std::map<std::string, std::string>& providers, std::vector<std::string>& out) {
+        std::map<std::string, size_t> pending;
+        std::map<std::string, std::vector<std::string>> importers;
+        for (const auto& src : units) {
+            std::set<std::string> deps;
+            for (const auto& req : infos.at(src).imports) {
+                auto it = providers.find(req);
+                if (it != providers.end() && it->second != src) deps.insert(it->second);
+            }
+            pending[src] = deps.size();
+            for (const auto& dep : deps) importers[dep].push_back(src);
         }
-        if (command_exists("g++")) {
-            out_cmd = "g++";
-            return CompilerType::GCC;
+
+        std::vector<std::string> ready;
+        for (const auto& src : units) {
+            if (pending[src] == 0) ready.push_back(src);
         }
-        if (command_exists("cl")) {
-            out_cmd = "cl";
-            return CompilerType::MSVC;
+        while (!ready.empty()) {
+            std::string src = ready.front();
+            ready.erase(ready.begin());
+            out.push_back(src);
+            for (const auto& next : importers[src]) {
+                if (--pending[next] == 0) ready.push_back(next);
+            }
         }
-        return CompilerType::Unknown;
-    }
 
-    static bool detect_nvcc(std::string& out_cmd) {
-        if (command_exists("nvcc")) {
-            out_cmd = "nvcc";
-            return true;
+        if (out.size() == units.size()) return true;
+        std::cerr << "Error: Module import cycle between:";
+        for (const auto& src : units) {
+            if (pending[src] > 0) std::cerr << " " << src;
         }
+        std::cerr << std::endl;
         return false;
     }
 
+    CompilerType Builder::detect_compiler(std::string& out_cmd) {
+        ToolchainInfo toolchain;
+        if (!Toolchain::detect(toolchain)) return CompilerType::Unknown;
+        out_cmd = toolchain.command;
+        return toolchain.type;
+    }
+
+    // Runs a probe such as pkg-config and returns its stdout.
     static std::string exec(const char* cmd) {
-        return exec_cmd(cmd);
+        ProcessOptions options;
+        options.merge_stderr = false;
+        std::string result = Timings::run(cmd, "probe", std::string(cmd), options).output;
+        if (!result.empty() && result.back() == '\n') result.pop_back();
+        return result;
     }
 
-    void Builder::build(const Config& config) {
-        std::string compiler_cmd;
-        CompilerType compiler_type = detect_compiler(compiler_cmd);
+    std::string Builder::compile_flags(const Config& config, CompilerType type) {
+        std::string flags;
+        if (type == CompilerType::MSVC)
+            flags = "/Iinclude /Ibuild/generated ";
+        else
+            flags = "-Iinclude -Ibuild/generated ";
 
-        if (compiler_type == CompilerType::Unknown) {
-            std::cerr << "Error: No suitable compiler (g++, clang++, cl) found in PATH.\n";
-            return;
+        // Add custom include directories
+        for (const auto& dir : config.build.include_dirs) {
+            if (dir.empty()) continue;
+            flags += Process::quote((type == CompilerType::MSVC ? "/I" : "-I") + dir) + " ";
         }
 
-        if (!fs::exists("build"))
-            fs::create_directories("build");
-        
-        if (!fs::exists("build/generated"))
-            fs::create_directories("build/generated");
+        // Add custom flags for compilation
+        for (const auto& flag : config.build.flags) {
+            if (flag.empty()) continue;
+            flags += flag + " ";
+        }
+
+        // Add defines
+        for (const auto& def : config.build.defines) {
+            if (def.empty()) continue;
+            flags += (type == CompilerType::MSVC ? "/D" : "-D") + def + " ";
+        }
+        return flags;
+    }
+
+    std::string Builder::dependency_include_flags(CompilerType type) {
+        std::string flags;
+        if (!fs::exists(".mule/deps")) return flags;
+
+        for (const auto& entry : fs::directory_iterator(".mule/deps")) {
+            if (!entry.is_directory()) continue;
+            // CMake dependencies are installed, with any headers their configure step
+            // generates. The prefix may only be filled later in this build, so always add it.
+            if (fs::exists(entry.path() / "CMakeLists.txt") && !fs::exists(entry.path() / "mule.toml")) {
+                std::string install = PackageManager::install_dir(entry.path().filename().string());
+                flags += Process::quote((type == CompilerType::MSVC ? "/I" : "-I") + install + "/include") + " ";
+            }
+            // Try to discover include directories automatically
+            std::vector<std::string> search_paths = {
+                entry.path().string(),
+                (entry.path() / "include").string(),
+                (entry.path() / "src").string()
+            };
+
+            for (const auto& sp : search_paths) {
+                if (fs::exists(sp)) {
+                    flags += Process::quote((type == CompilerType::MSVC ? "/I" : "-I") + sp) + " ";
+                }
+            }
+        }
+        return flags;
+    }
+
+    // Include paths of a Mule package: its include/ and src/ and its [build] include_dirs.
+    static std::string package_include_flags(const MulePackage& package, CompilerType type) {
+        std::string include = type == CompilerType::MSVC ? "/I" : "-I";
+        fs::path root = package.path;
+        std::string flags = Process::quote(include + (root / "include").string()) + " " + Process::quote(include + (root / "src").string()) + " ";
+        for (const auto& dir : package.config.build.include_dirs) {
+            if (dir.empty()) continue;
+            flags += Process::quote(include + (root / dir).string()) + " ";
+        }
+        return flags;
+    }
+
+    // Include paths, flags and defines the TUs of a Mule package are compiled with, taken
+    // from its own mule.toml.
+    static std::string package_compile_flags(const MulePackage& package, CompilerType type) {
+        std::string flags = package_include_flags(package, type);
+        for (const auto& flag : package.config.build.flags) {
+            if (flag.empty()) continue;
+            flags += flag + " ";
+        }
+        for (const auto& def : package.config.build.defines) {
+            if (def.empty()) continue;
+            flags += (type == CompilerType::MSVC ? "/D" : "-D") + def + " ";
+        }
+        return flags;
+    }
+
+    // Sources of a Mule package: src/ minus unit tests, and minus main.cpp unless with_main.
+    static std::vector<std::string> package_sources(const MulePackage& package, bool with_main) {
+        std::vector<std::string> sources;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(fs::path(package.path) / "src", ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (!it->is_regular_file() || it->path().extension() != ".cpp") continue;
+            if ((name == "main.cpp" && !with_main) || name.find("_test.cpp") != std::string::npos) continue;
+            sources.push_back(it->path().string());
+        }
+        std::sort(sources.begin(), sources.end());
+        return sources;
+    }
+
+    // The objects of a Mule package, and which of their compiles were queued.
+    struct PackageJobs {
+        std::vector<std::string> objs;
+        std::vector<size_t> compile_jobs;
+    };
+
+    // Queues the compiles of sources, a Mule package's files, into out_dir with the package's
+    // own C++ standard.
+    static PackageJobs queue_package_compiles(JobQueue& queue, const MulePackage& package, const std::vector<std::string>& sources,
+                                              const fs::path& out_dir, const std::string& flags, CompilerType type,
+                                              const std::string& compiler_cmd, bool is_shared) {
+        PackageJobs result;
+        fs::create_directories(out_dir);
+        for (const auto& src : sources) {
+            fs::path src_path = src;
+            fs::path obj_path = out_dir / src_path.filename().replace_extension(get_obj_extension(type));
+
+            Job job;
+            job.description = "Compiling " + package.name + ": " + src_path.filename().string();
+            job.command = make_compile_cmd(type, compiler_cmd, src, obj_path.string(), package.config.standard, flags, is_shared);
+            job.failure_message = "Compilation failed for " + src;
+            job.response_file = obj_path.string() + ".rsp";
+            result.objs.push_back(obj_path.string());
+            if (queue.queue(job, {obj_path.string(), DepTracker::depfile_path(obj_path.string(), type), src, true, {}})) {
+                result.compile_jobs.push_back(queue.jobs.size() - 1);
+            }
+        }
+        return result;
+    }
+
+    bool Builder::prepare_pch(const Config& config, CompilerType type, const std::string& compiler_cmd,
+                              const std::string& flags, BuildDb& db, PrecompiledHeader& out) {
+        out = PrecompiledHeader{};
+        if (config.build.pch.empty()) return true;
+
+        fs::path header = config.build.pch;
+        if (!fs::exists(header)) {
+            std::cerr << "Error: precompiled header '" << config.build.pch << "' not found." << std::endl;
+            return false;
+        }
+
+        // One PCH per compiler and flag set, so the test runner and every profile reuse
+        // whichever one matches their command line
+        bool is_shared = config.type == "shared-lib";
+        uint64_t key = hash_string(compiler_cmd + "\n" + config.standard + "\n" + flags + (is_shared ? "\nshared" : ""));
+        fs::path dir = fs::path("build") / "pch" / (fs::path(compiler_cmd).stem().string() + "-" + to_hex(key));
+        fs::create_directories(dir);
+
+        // TUs include a stub next to the PCH that forwards to the real header. GCC finds
+        // stub.gch on its own and falls back to the stub's #include if the PCH is rejected.
+        std::string name = header.filename().string();
+        fs::path stub = dir / name;
+        std::string stub_content = "#include \"" + fs::relative(header, dir).generic_string() + "\"\n";
+        std::ifstream existing(stub);
+        std::string existing_content((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+        existing.close();
+        if (existing_content != stub_content) {
+            std::ofstream(stub) << stub_content;
+        }
+
+        std::string output;
+        std::string cmd;
+        std::string depfile;
+        if (type == CompilerType::MSVC) {
+            fs::path stub_cpp = dir / "pch.cpp";
+            if (!fs::exists(stub_cpp)) std::ofstream(stub_cpp) << "#include \"" << name << "\"\n";
+            output = (dir / (name + ".pch")).string();
+            out.object = (dir / "pch.obj").string();
+            depfile = DepTracker::depfile_path(out.object, type);
+            cmd = compiler_cmd + " /std:c++" + config.standard + " /c " + Process::quote(stub_cpp.string()) + " " + Process::quote("/Yc" + name) +
+                  " " + Process::quote("/Fp" + output) + " " + Process::quote("/Fo" + out.object) + " /EHsc " + Process::quote("/I" + dir.string()) +
+                  " " + DepTracker::depfile_flags(depfile, type) + flags;
+            out.compile_flags = Process::quote("/I" + dir.string()) + " " + Process::quote("/Yu" + name) + " " + Process::quote("/FI" + name) +
+                                " " + Process::quote("/Fp" + output) + " ";
+        } else {
+            std::string pic = is_shared ? "-fPIC " : "";
+            output = stub.string() + (type == CompilerType::Clang ? ".pch" : ".gch");
+            depfile = output + ".d";
+            cmd = compiler_cmd + " -std=c++" + config.standard + " " + pic + prefix_map_flag(type) + DepTracker::depfile_flags(depfile, type) +
+                  "-x c++-header " + Process::quote(stub.string()) + " -o " + Process::quote(output) + " " + flags;
+            if (type == CompilerType::Clang)
+                out.compile_flags = "-include-pch " + Process::quote(output) + " ";
+            else
+                out.compile_flags = "-include " + Process::quote(stub.string()) + " -Winvalid-pch ";
+        }
+
+        if (!db.is_up_to_date(output, cmd)) {
+            std::cout << "Precompiling header: " << config.build.pch << std::endl;
+            ProcessResult result = Timings::run("Precompiling header: " + config.build.pch, "pch", cmd);
+            if (!result.output.empty()) std::cout << result.output << std::flush;
+            if (result.exit_code != 0) {
+                std::cerr << "Precompiling " << config.build.pch << " failed." << std::endl;
+                return false;
+            }
+            db.record(output, cmd, DepTracker::parse_depfile(depfile));
+        }
+
+        out.inputs = DepTracker::parse_depfile(depfile);
+        return true;
+    }
+
+    // CMake build type of the dependencies in each profile. The dev profile still optimizes
+    // them, keeping debug info.
+    static std::string dependency_build_type(const BuildOptions& options) {
+        return options.release ? "Release" : "RelWithDebInfo";
+    }
+
+    static std::string profile_flags(CompilerType type, const BuildOptions& options) {
+        if (!options.release) return "";
+        return type == CompilerType::MSVC ? "/O2 /DNDEBUG " : "-O2 -DNDEBUG ";
+    }
+
+    // Queues the jobs of the out of date CMake and Make dependency builds. Returns, for each
+    // build, one past the index of its last job. Compiles queued afterwards wait for the CMake
+    // installs: the install prefix, which is on the include path, starts out empty.
+    static std::vector<size_t> queue_dependency_builds(JobQueue& queue, const std::vector<DependencyBuild>& builds) {
+        std::vector<size_t> job_ends;
+        for (const auto& build : builds) {
+            size_t first = queue.jobs.size();
+            for (Job job : build.jobs) {
+                for (auto& dep : job.deps) dep += first;
+                queue.jobs.push_back(job);
+                queue.outputs.push_back({"dependency: " + job.description, "", "", false, {}, true});
+            }
+            if (!build.install_dir.empty() && !build.jobs.empty()) queue.installs.push_back(queue.jobs.size() - 1);
+            job_ends.push_back(queue.jobs.size());
+        }
+        return job_ends;
+    }
+
+    // Stamps the dependency builds all of whose jobs succeeded.
+    static void write_dependency_stamps(const std::vector<Job>& jobs, const std::vector<DependencyBuild>& builds,
+                                        const std::vector<size_t>& job_ends) {
+        size_t first = 0;
+        for (size_t b = 0; b < job_ends.size(); ++b) {
+            bool built = true;
+            for (size_t i = first; i < job_ends[b]; ++i) built = built && jobs[i].status == JobStatus::Succeeded;
+            if (built) PackageManager::write_dependency_stamp(builds[b]);
+            first = job_ends[b];
+        }
+    }
+
+    // Runs the dependency builds ahead of everything else. The precompiled header is compiled
+    // before any job runs, so the headers it includes must already be installed.
+    static bool run_dependency_builds(BuildDb& db, const std::vector<DependencyBuild>& builds, const BuildOptions& options) {
+        JobQueue queue{db, nullptr, {}, {}};
+        std::vector<size_t> job_ends = queue_dependency_builds(queue, builds);
+        if (queue.jobs.empty()) return true;
+        bool ok = run_jobs(queue, options);
+        write_dependency_stamps(queue.jobs, builds, job_ends);
+        return ok;
+    }
+
+    // Queues archiving objs into archive after the jobs in deps, unless the archive is up to
+    // date. Returns the index of the archive step if it was queued.
+    static std::optional<size_t> queue_archive(JobQueue& queue, CompilerType type, const std::string& description,
+                                               const std::vector<std::string>& objs, const std::string& archive,
+                                               const std::vector<size_t>& deps) {
+        Job job;
+        job.description = description;
+        job.command = make_archive_cmd(type, objs, archive);
+        job.failure_message = "Archiving failed for " + archive;
+        job.deps = deps;
+        if (deps.empty() && queue.db.is_up_to_date(archive, job.command)) return std::nullopt;
+        queue.jobs.push_back(job);
+        queue.outputs.push_back({archive, "", "", false, objs});
+        return queue.jobs.size() - 1;
+    }
+
+    // The libraries of the Mule packages among the dependencies, as queued for a build.
+    struct PackageLibraries {
+        std::vector<std::string> archives; // Dependents before their dependencies, for the linker
+        std::vector<std::string> outputs;  // Every object and archive
+        std::vector<size_t> jobs;          // Archive steps that run
+    };
+
+    // Queues the library of every Mule package among the dependencies, compiled with its own
+    // mule.toml plus extra_flags and archived into build/deps/<name> once its objects are
+    // done. Packages of type bin only provide headers.
+    static PackageLibraries queue_dependency_packages(JobQueue& queue, const std::vector<MulePackage>& packages, CompilerType type,
+                                                      const std::string& compiler_cmd, const std::string& extra_flags, bool is_shared) {
+        PackageLibraries result;
+        for (const auto& package : packages) {
+            if (package.config.type == "bin") continue;
+            fs::path out_dir = fs::path("build") / "deps" / package.name;
+            PackageJobs compiled = queue_package_compiles(queue, package, package_sources(package, false), out_dir,
+                                                          package_compile_flags(package, type) + extra_flags, type, compiler_cmd, is_shared);
+            if (compiled.objs.empty()) continue;
+
+            std::string archive = (out_dir / fs::path(get_target_path(type, "static-lib", package.name)).filename()).string();
+            auto job = queue_archive(queue, type, "Archiving dependency [" + package.name + "]...", compiled.objs, archive, compiled.compile_jobs);
+            if (job) result.jobs.push_back(*job);
+            result.archives.insert(result.archives.begin(), archive);
+            result.outputs.insert(result.outputs.end(), compiled.objs.begin(), compiled.objs.end());
+            result.outputs.push_back(archive);
+        }
+        return result;
+    }
+
+    // Adds the library directories, libs and linker flags that packages declare to config,
+    // dependents first so they follow the archives that need them.
+    static void add_package_link_flags(const std::vector<MulePackage>& packages, Config& config) {
+        for (auto it = packages.rbegin(); it != packages.rend(); ++it) {
+            const BuildConfig& build = it->config.build;
+            for (const auto& dir : build.lib_dirs) config.build.lib_dirs.push_back((fs::path(it->path) / dir).string());
+            config.build.libs.insert(config.build.libs.end(), build.libs.begin(), build.libs.end());
+            config.build.linker_flags.insert(config.build.linker_flags.end(), build.linker_flags.begin(), build.linker_flags.end());
+        }
+    }
+
+    // Resolves everything that only changes with mule.toml, the toolchain or the fetched
+    // dependencies: the compiler, pkg-config flags and the dependency builds.
+    static bool prepare_session(const Config& config, const BuildOptions& options, BuildSession& session) {
+        ToolchainInfo toolchain;
+        if (!Toolchain::detect(toolchain)) {
+            std::cerr << "Error: No suitable compiler (g++, clang++, cl) found in PATH.\n";
+            return false;
+        }
+        session.compiler_type = toolchain.type;
+        session.compiler_cmd = toolchain.command;
+        session.compiler_identity = toolchain.identity();
+        session.nvcc_cmd = toolchain.nvcc;
 
         Config active_config = config;
 
@@ -204,32 +732,154 @@ namespace mule {
             }
         }
 
+        // Fetch dependencies using PackageManager
+        FetchOptions fetch_options;
+        fetch_options.offline = options.offline;
+        fetch_options.locked = options.locked;
+        std::vector<Dependency> resolved;
+        if (!PackageManager::fetch_dependencies(active_config.dependencies, fetch_options, resolved)) return false;
+        if (!options.locked) PackageManager::write_lockfile(resolved);
+        if (!PackageManager::mule_packages(resolved, session.packages)) return false;
+        int jobs = options.jobs > 0 ? options.jobs : JobScheduler::default_jobs();
+        session.dependencies = resolved;
+        session.dependency_builds = PackageManager::dependency_builds(resolved, session.compiler_identity, active_config.standard,
+                                                                      dependency_build_type(options), jobs, options.use_cache);
+        session.dependencies_built = false;
+        session.dependency_flags = Builder::dependency_include_flags(session.compiler_type);
+
+        session.active_config = active_config;
+        session.prepared = true;
+        return true;
+    }
+
+    // Records what a successful build depended on, so the next mule build can prove it is
+    // up to date from file stats alone.
+    static void write_build_stamp(const BuildOptions& options, const BuildSession& session, const std::string& target,
+                                  const std::vector<std::string>& outputs) {
+        std::vector<std::string> files = {target};
+        for (const auto& output : outputs) {
+            std::vector<std::string> inputs = session.db.inputs_of(output);
+            // Not recorded, e.g. because a source was saved while it compiled: only the full
+            // check can tell that it has to be rebuilt
+            if (inputs.empty()) return;
+            files.push_back(output);
+            files.insert(files.end(), inputs.begin(), inputs.end());
+        }
+        std::error_code ec;
+        fs::path compiler = fs::canonical(find_executable(session.compiler_cmd), ec);
+        if (!ec) files.push_back(compiler.string());
+
+        // Directory mtimes change when files are added, removed or renamed
+        std::vector<std::string> dirs;
+        if (fs::exists("src")) dirs.push_back("src");
+        for (const auto& file : session.src_files) {
+            for (fs::path dir = fs::path(file).parent_path(); !dir.empty() && dir != "src"; dir = dir.parent_path()) {
+                dirs.push_back(dir.string());
+            }
+        }
+
+        for (const auto& dep : session.active_config.dependencies) {
+            if (!dep.path.empty()) {
+                // Path dependencies are edited in place, their whole tree counts
+                if (!fs::is_directory(dep.path)) continue;
+                dirs.push_back(dep.path);
+                for (auto it = fs::recursive_directory_iterator(dep.path, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                    if (ec) break;
+                    std::string name = it->path().filename().string();
+                    if (it->is_directory(ec)) {
+                        if (name == "build" || name[0] == '.') {
+                            it.disable_recursion_pending();
+                        } else {
+                            dirs.push_back(it->path().string());
+                        }
+                    } else {
+                        files.push_back(it->path().string());
+                    }
+                }
+            }
+            // Git dependencies are store worktrees of the commits mule.lock pins, and the
+            // lockfile is part of the stamp key
+        }
+
+        BuildStamp::write(options, target, files, dirs);
+    }
+
+    bool Builder::build(const Config& config, const BuildOptions& options) {
+        // No-op fast path: nothing the last successful build depended on has changed. Skipped
+        // for --timings, which always writes a report of the steps it checked.
+        std::string target;
+        if (!options.rebuild && !options.timings && BuildStamp::is_current(options, target)) {
+            std::cout << target << " is up to date." << std::endl;
+            return true;
+        }
+
+        BuildSession session;
+        return build(config, options, session);
+    }
+
+    // The body of Builder::build, which wraps it with --timings recording.
+    static bool run_build(const Config& config, const BuildOptions& options, BuildSession& session) {
+        BuildStamp::invalidate();
+        if (!session.prepared && !prepare_session(config, options, session)) return false;
+        CompilerType compiler_type = session.compiler_type;
+        const std::string& compiler_cmd = session.compiler_cmd;
+        Config active_config = session.active_config;
+
+        if (!fs::exists("build"))
+            fs::create_directories("build");
+        
+        if (!fs::exists("build/generated"))
+            fs::create_directories("build/generated");
+
+        if (!session.db_loaded) {
+            session.db.load();
+            session.db_loaded = true;
+        }
+        BuildDb& db = session.db;
+
+        std::optional<CompileCache> cache;
+        if (options.use_cache) cache.emplace(session.compiler_identity);
+
+        if (!session.sources_indexed) {
+            session.src_files.clear();
+            if (fs::exists("src")) {
+                for (const auto& entry : fs::recursive_directory_iterator("src")) {
+                    if (entry.is_regular_file()) session.src_files.push_back(entry.path().string());
+                }
+            }
+            session.sources_indexed = true;
+        }
+
         // Run Generators
         std::vector<std::string> generated_sources;
+        std::vector<std::string> generated_outputs;
         for (const auto& gen : active_config.generators) {
-            if (!fs::exists("src")) continue;
-            for (const auto& entry : fs::recursive_directory_iterator("src")) {
-                if (entry.path().extension().string() == gen.input_extension) {
-                    if (!file_contains(entry.path().string(), gen.match_content)) {
+            for (const auto& file : session.src_files) {
+                fs::path path = file;
+                if (path.extension().string() == gen.input_extension) {
+                    if (!file_contains(file, gen.match_content)) {
                         continue;
                     }
 
-                    std::string input = entry.path().string();
-                    std::string output = "build/generated/" + entry.path().filename().string() + gen.output_extension;
-                    
-                    bool needs_gen = !fs::exists(output) || fs::last_write_time(input) > fs::last_write_time(output);
+                    std::string input = file;
+                    std::string output = "build/generated/" + path.filename().string() + gen.output_extension;
                     
-                    if (needs_gen) {
-                        std::string cmd = gen.command;
-                        cmd = replace_all(cmd, "{input}", input);
-                        cmd = replace_all(cmd, "{output}", output);
-                        
-                        std::cout << "Generating: " << output << " from " << entry.path().filename() << " (" << gen.name << ")" << std::endl;
-                        if (std::system(cmd.c_str()) != 0) {
+                    std::string cmd = gen.command;
+                    cmd = replace_all(cmd, "{input}", input);
+                    cmd = replace_all(cmd, "{output}", output);
+
+                    if (!db.is_up_to_date(output, cmd)) {
+                        std::cout << "Generating: " << output << " from " << path.filename() << " (" << gen.name << ")" << std::endl;
+                        ProcessResult result = Timings::run("Generating: " + output, "generate", cmd);
+                        std::cout << result.output << std::flush;
+                        if (result.exit_code != 0) {
                             std::cerr << "Generator " << gen.name << " failed for " << input << std::endl;
-                            return;
+                            db.save();
+                            return false;
                         }
+                        db.record(output, cmd, {input});
                     }
+                    generated_outputs.push_back(output);
                     
                     if (fs::path(output).extension() == ".cpp" || fs::path(output).extension() == ".cc") {
                         generated_sources.push_back(output);
@@ -238,114 +888,207 @@ namespace mule {
             }
         }
         
-        std::string include_flags;
-        if (compiler_type == CompilerType::MSVC)
-            include_flags = "/Iinclude /Ibuild/generated ";
-        else
-            include_flags = "-Iinclude -Ibuild/generated ";
+        std::string include_flags = Builder::compile_flags(active_config, compiler_type) + session.dependency_flags + profile_flags(compiler_type, options);
 
-        // Add custom include directories
-        for (const auto& dir : active_config.build.include_dirs) {
-            if (dir.empty()) continue;
-            include_flags += (compiler_type == CompilerType::MSVC ? "/I" : "-I") + dir + " ";
+        bool dependencies_first = !session.dependencies_built && !active_config.build.pch.empty();
+        if (dependencies_first && !run_dependency_builds(db, session.dependency_builds, options)) {
+            db.save();
+            return false;
         }
-
-        // Add custom flags to include_flags for compilation
-        for (const auto& flag : active_config.build.flags) {
-            if (flag.empty()) continue;
-            include_flags += flag + " ";
+        PrecompiledHeader pch;
+        if (!Builder::prepare_pch(active_config, compiler_type, compiler_cmd, include_flags, db, pch)) {
+            db.save();
+            return false;
         }
+        std::string cxx_flags = include_flags + pch.compile_flags;
+        if (options.time_trace && compiler_type == CompilerType::Clang) cxx_flags += "-ftime-trace ";
 
-        // Add defines
-        for (const auto& def : active_config.build.defines) {
-            if (def.empty()) continue;
-            include_flags += (compiler_type == CompilerType::MSVC ? "/D" : "-D") + def + " ";
-        }
+        std::vector<std::string> obj_files;
+        JobQueue job_queue{db, cache ? &*cache : nullptr, {}, {}};
+        std::vector<Job>& jobs = job_queue.jobs;
+        std::vector<JobOutput>& job_outputs = job_queue.outputs;
+        std::string obj_ext = get_obj_extension(compiler_type);
 
-        // Fetch dependencies using PackageManager
-        auto resolved = PackageManager::fetch_dependencies(active_config.dependencies);
-        PackageManager::write_lockfile(resolved);
-        PackageManager::build_dependencies(resolved, compiler_type);
-
-        if (fs::exists(".mule/deps")) {
-            for (const auto& entry : fs::directory_iterator(".mule/deps")) {
-                if (entry.is_directory()) {
-                    // Try to discover include directories automatically
-                    std::vector<std::string> search_paths = {
-                        entry.path().string(),
-                        (entry.path() / "include").string(),
-                        (entry.path() / "src").string()
-                    };
-
-                    for (const auto& sp : search_paths) {
-                        if (fs::exists(sp)) {
-                            include_flags += (compiler_type == CompilerType::MSVC ? "/I" : "-I") + sp + " ";
-                        }
-                    }
+        // Dependency builds run alongside the project's compiles; only the link waits for them
+        std::vector<size_t> dependency_job_ends; // One past the last job of each dependency build
+        if (!session.dependencies_built && !dependencies_first) dependency_job_ends = queue_dependency_builds(job_queue, session.dependency_builds);
 
-                    // Also search for libraries in 'build' or 'lib' directories of the dependency
-                    std::vector<std::string> lib_paths = {
-                        (entry.path() / "build").string(),
-                        (entry.path() / "lib").string()
-                    };
-                    for (const auto& lp : lib_paths) {
-                        if (fs::exists(lp)) {
-                            active_config.build.lib_dirs.push_back(lp);
-                        }
-                    }
-                }
-            }
-        }
+        // Queues one of the project's own objects. Returns true if the job was queued, false
+        // if its output is up to date or cached.
+        auto schedule = [&](Job job, const JobOutput& out, bool force = false) {
+            obj_files.push_back(out.path);
+            return job_queue.queue(job, out, force || options.rebuild);
+        };
 
-        std::vector<std::string> obj_files;
-        std::string obj_ext = get_obj_extension(compiler_type);
+        auto schedule_cpp = [&](const fs::path& src_path, const std::string& description) {
+            fs::path obj_path = fs::path("build") / src_path.filename().replace_extension(obj_ext);
+
+            Job job;
+            job.description = description;
+            job.command = make_compile_cmd(compiler_type, compiler_cmd, src_path.string(), obj_path.string(), active_config.standard, cxx_flags, active_config.type == "shared-lib");
+            job.failure_message = "Compilation failed for " + src_path.string();
+            job.response_file = obj_path.string() + ".rsp";
+            schedule(job, {obj_path.string(), DepTracker::depfile_path(obj_path.string(), compiler_type), src_path.string(), true, pch.inputs});
+        };
+
+        // Mule packages among the dependencies are compiled in this same run
+        PackageLibraries packages = queue_dependency_packages(job_queue, session.packages, compiler_type, compiler_cmd,
+                                                              session.dependency_flags + profile_flags(compiler_type, options),
+                                                              active_config.type == "shared-lib");
 
         // Compile regular sources
-        if (fs::exists("src")) {
-            for (const auto &entry : fs::recursive_directory_iterator("src")) {
-                if (entry.path().extension() == ".cpp") {
-                    fs::path src_path = entry.path();
-                    fs::path obj_path = fs::path("build") / src_path.filename().replace_extension(obj_ext);
+        bool modules_enabled = ModuleScanner::standard_has_modules(active_config.standard);
+        std::vector<std::string> cpp_sources;
+        for (const auto& file : session.src_files) {
+            fs::path src_path = file;
+            if (src_path.extension() == ".cpp" || (modules_enabled && ModuleScanner::is_interface_extension(file))) {
+                cpp_sources.push_back(file);
+            } else if (src_path.extension() == ".cu") {
+                if (!active_config.cuda.enabled) continue;
 
-                    bool needs_rebuild = !fs::exists(obj_path) ||
-                                         fs::last_write_time(src_path) > fs::last_write_time(obj_path);
+                const std::string& nvcc_cmd = session.nvcc_cmd;
+                if (nvcc_cmd.empty()) {
+                    std::cerr << "Error: nvcc not found but .cu files are present.\n";
+                    return false;
+                }
 
-                    if (needs_rebuild) {
-                        std::string cmd = make_compile_cmd(compiler_type, compiler_cmd, src_path.string(), obj_path.string(), active_config.standard, include_flags, active_config.type == "shared-lib");
+                fs::path obj_path = fs::path("build") / src_path.filename().replace_extension(obj_ext);
+                std::string depfile = DepTracker::depfile_path(obj_path.string(), CompilerType::GCC); // nvcc always writes Make syntax
 
-                        std::cout << "Compiling: " << src_path.filename() << std::endl;
-                        if (std::system(cmd.c_str()) != 0) {
-                            std::cerr << "Compilation failed for " << src_path << std::endl;
-                            return;
-                        }
-                    }
-                    obj_files.push_back(obj_path.string());
-                } else if (entry.path().extension() == ".cu") {
-                    if (!active_config.cuda.enabled) continue;
-
-                    std::string nvcc_cmd;
-                    if (!detect_nvcc(nvcc_cmd)) {
-                        std::cerr << "Error: nvcc not found but .cu files are present.\n";
-                        return;
+                Job job;
+                job.description = "Compiling CUDA: " + src_path.filename().string();
+                job.command = nvcc_cmd + " -MMD -MF " + depfile + " -c " + src_path.string() + " -o " + obj_path.string() + " " + include_flags;
+                job.failure_message = "CUDA compilation failed for " + src_path.string();
+                schedule(job, {obj_path.string(), depfile, src_path.string(), false, {}});
+            }
+        }
+
+        // C++20 modules: TUs that provide or import a project module are compiled in
+        // dependency order, ahead of (and excluded from) everything else
+        if (modules_enabled) {
+            ModuleScanner scanner(compiler_type);
+            scanner.load();
+            std::map<std::string, ModuleInfo> infos;
+            std::map<std::string, std::string> providers; // Module name -> interface TU
+            for (const auto& src : cpp_sources) {
+                std::string obj = (fs::path("build") / fs::path(src).filename().replace_extension(obj_ext)).string();
+                std::string scan_cmd = make_compile_cmd(compiler_type, compiler_cmd, src, obj, active_config.standard, cxx_flags, active_config.type == "shared-lib");
+                ModuleInfo info;
+                if (!scanner.scan(db, src, scan_cmd, info)) {
+                    std::cerr << "Error: Failed to scan module dependencies of " << src << std::endl;
+                    db.save();
+                    return false;
+                }
+                if (!info.provides.empty()) {
+                    auto [it, inserted] = providers.emplace(info.provides, src);
+                    if (!inserted) {
+                        std::cerr << "Error: Module '" << info.provides << "' is provided by both " << it->second << " and " << src << std::endl;
+                        db.save();
+                        return false;
                     }
+                }
+                infos[src] = info;
+            }
+            scanner.save();
+
+            std::vector<std::string> units, plain_sources;
+            for (const auto& src : cpp_sources) {
+                const ModuleInfo& info = infos[src];
+                bool imports_project_module = false;
+                for (const auto& req : info.imports) {
+                    if (providers.count(req)) imports_project_module = true;
+                }
+                if (!info.provides.empty() || imports_project_module) {
+                    units.push_back(src);
+                } else {
+                    plain_sources.push_back(src);
+                }
+            }
 
-                    fs::path src_path = entry.path();
+            if (!units.empty()) {
+                std::vector<std::string> ordered;
+                if (!sort_module_units(units, infos, providers, ordered)) {
+                    db.save();
+                    return false;
+                }
+
+                // BMIs are only compatible with the exact compiler and flags that made them
+                fs::path bmi_dir = fs::path("build") / "modules" /
+                    (fs::path(compiler_cmd).stem().string() + "-" + to_hex(hash_string(compiler_cmd + "\n" + active_config.standard + "\n" + cxx_flags)));
+                fs::create_directories(bmi_dir);
+                if (compiler_type == CompilerType::GCC) {
+                    std::string mapper;
+                    for (const auto& [name, src] : providers) mapper += name + " " + bmi_path(bmi_dir, name, compiler_type) + "\n";
+                    fs::path mapper_path = bmi_dir / "mapper.txt";
+                    std::ifstream existing(mapper_path);
+                    std::string existing_content((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+                    existing.close();
+                    if (existing_content != mapper) std::ofstream(mapper_path) << mapper;
+                }
+                std::string search_flags = module_search_flags(compiler_type, bmi_dir);
+
+                std::map<std::string, size_t> unit_jobs; // Interface TU -> job index, if rebuilt
+                for (const auto& src : ordered) {
+                    const ModuleInfo& info = infos[src];
+                    fs::path src_path = src;
                     fs::path obj_path = fs::path("build") / src_path.filename().replace_extension(obj_ext);
+                    bool is_interface = !info.provides.empty();
+                    std::string bmi = is_interface ? bmi_path(bmi_dir, info.provides, compiler_type) : "";
 
-                    bool needs_rebuild = !fs::exists(obj_path) ||
-                                         fs::last_write_time(src_path) > fs::last_write_time(obj_path);
+                    Job job;
+                    job.description = "Compiling module: " + src_path.filename().string();
+                    std::string flags = cxx_flags + search_flags + (is_interface ? module_interface_flags(compiler_type, bmi) : "");
+                    job.command = make_compile_cmd(compiler_type, compiler_cmd, src, obj_path.string(), active_config.standard, flags,
+                                                   active_config.type == "shared-lib", module_lang(compiler_type, src, is_interface));
+                    job.failure_message = "Compilation failed for " + src;
+                    job.response_file = obj_path.string() + ".rsp";
 
-                    if (needs_rebuild) {
-                        std::string cmd = nvcc_cmd + " -c " + src_path.string() + " -o " + obj_path.string() + " " + include_flags;
-                        std::cout << "Compiling CUDA: " << src_path.filename() << std::endl;
-                        if (std::system(cmd.c_str()) != 0) {
-                            std::cerr << "CUDA compilation failed for " << src_path << std::endl;
-                            return;
+                    // Importers must be rebuilt whenever an interface they use is
+                    std::vector<std::string> extra_inputs = pch.inputs;
+                    bool force = is_interface && !fs::exists(bmi);
+                    for (const auto& req : info.imports) {
+                        auto provider = providers.find(req);
+                        if (provider == providers.end() || provider->second == src) continue;
+                        extra_inputs.push_back(bmi_path(bmi_dir, req, compiler_type));
+                        auto dep = unit_jobs.find(provider->second);
+                        if (dep != unit_jobs.end()) {
+                            job.deps.push_back(dep->second);
+                            force = true;
                         }
                     }
-                    obj_files.push_back(obj_path.string());
+
+                    JobOutput out{obj_path.string(), DepTracker::depfile_path(obj_path.string(), compiler_type), src, false, extra_inputs};
+                    if (schedule(job, out, force)) unit_jobs[src] = jobs.size() - 1;
                 }
             }
+            cpp_sources = plain_sources;
+        }
+
+        size_t unity_batch = active_config.build.unity_batch > 0 ? static_cast<size_t>(active_config.build.unity_batch)
+                                                                  : (options.unity ? UnityBuild::DEFAULT_BATCH_SIZE : 0);
+        if (unity_batch > 0) {
+            std::vector<std::string> batched;
+            for (const auto& src : cpp_sources) {
+                fs::path src_path = src;
+                bool excluded = false;
+                for (const auto& pattern : active_config.build.unity_exclude) {
+                    if (pattern == src_path.generic_string() || pattern == src_path.filename().string()) excluded = true;
+                }
+                if (excluded) {
+                    schedule_cpp(src_path, "Compiling: " + src_path.filename().string());
+                } else {
+                    batched.push_back(src);
+                }
+            }
+            if (!batched.empty()) {
+                for (const auto& unity_src : UnityBuild::generate(batched, unity_batch)) {
+                    schedule_cpp(unity_src, "Compiling unity batch: " + fs::path(unity_src).filename().string());
+                }
+            }
+        } else {
+            for (const auto& src : cpp_sources) {
+                schedule_cpp(src, "Compiling: " + fs::path(src).filename().string());
+            }
         }
 
         // Compile generated sources
@@ -353,25 +1096,27 @@ namespace mule {
             fs::path src_path = src;
             fs::path obj_path = fs::path("build") / src_path.filename().replace_extension(obj_ext);
 
-            bool needs_rebuild = !fs::exists(obj_path) ||
-                                    fs::last_write_time(src_path) > fs::last_write_time(obj_path);
+            Job job;
+            job.description = "Compiling generated: " + src_path.filename().string();
+            job.command = make_compile_cmd(compiler_type, compiler_cmd, src_path.string(), obj_path.string(), active_config.standard, cxx_flags, active_config.type == "shared-lib");
+            job.failure_message = "Compilation failed for generated source " + src_path.string();
+            job.response_file = obj_path.string() + ".rsp";
+            schedule(job, {obj_path.string(), DepTracker::depfile_path(obj_path.string(), compiler_type), src_path.string(), true, pch.inputs});
+        }
 
-            if (needs_rebuild) {
-                std::string cmd = make_compile_cmd(compiler_type, compiler_cmd, src_path.string(), obj_path.string(), active_config.standard, include_flags, active_config.type == "shared-lib");
+        if (!pch.object.empty()) obj_files.push_back(pch.object);
+
+        std::vector<std::string> link_inputs = obj_files;
+        link_inputs.insert(link_inputs.end(), packages.archives.begin(), packages.archives.end());
+
+        // Link only once every object is done
+        Job link;
+        link.failure_message = "Linking/Archiving failed.";
+        for (size_t i = 0; i < jobs.size(); ++i) link.deps.push_back(i);
 
-                std::cout << "Compiling generated: " << src_path.filename() << std::endl;
-                if (std::system(cmd.c_str()) != 0) {
-                    std::cerr << "Compilation failed for generated source " << src_path << std::endl;
-                    return;
-                }
-            }
-            obj_files.push_back(obj_path.string());
-        }
-        
-        std::string link_cmd;
         if (active_config.type == "static-lib") {
-            link_cmd = make_archive_cmd(compiler_type, obj_files, active_config.project_name);
-            std::cout << "Archiving static library [lib" << active_config.project_name << "]..." << std::endl;
+            link.command = make_archive_cmd(compiler_type, obj_files, get_target_path(compiler_type, "static-lib", active_config.project_name));
+            link.description = "Archiving static library [lib" + active_config.project_name + "]...";
         } else {
             if (active_config.cuda.enabled) {
                 #ifdef _WIN32
@@ -380,20 +1125,399 @@ namespace mule {
                     active_config.build.linker_flags.push_back("-lcudart");
                 #endif
             }
-            link_cmd = make_link_cmd(compiler_type, compiler_cmd, obj_files, active_config.project_name, active_config);
+            std::string build_type = dependency_build_type(options);
+            const std::vector<Dependency>& dependencies = session.dependencies;
+            const std::vector<MulePackage>& mule_packages = session.packages;
+            auto link_command = [=, &dependencies, &mule_packages]() {
+                Config link_config = active_config;
+                add_package_link_flags(mule_packages, link_config);
+                PackageManager::link_dependencies(dependencies, build_type, link_config);
+                return make_link_cmd(compiler_type, compiler_cmd, link_inputs, get_target_path(compiler_type, link_config.type, link_config.project_name), link_config);
+            };
+            link.command = link_command();
+            // Dependencies built in this run only install their libraries right before the link
+            if (!dependency_job_ends.empty()) link.prepare = [link_command](Job& job) { job.command = link_command(); };
             std::string target_type = (active_config.type == "shared-lib") ? "shared library" : "executable";
-            std::cout << "Linking " << target_type << " [" << active_config.project_name << "]..." << std::endl;
+            link.description = "Linking " + target_type + " [" + active_config.project_name + "]...";
+        }
+
+        std::string target = get_target_path(compiler_type, active_config.type, active_config.project_name);
+        link.response_file = target + ".rsp";
+        std::vector<std::string> stamp_outputs = obj_files;
+        stamp_outputs.insert(stamp_outputs.end(), generated_outputs.begin(), generated_outputs.end());
+        stamp_outputs.insert(stamp_outputs.end(), packages.outputs.begin(), packages.outputs.end());
+        // A rebuilt or restored dependency means a new library to link against
+        bool dependencies_changed = !session.dependencies_built && !session.dependency_builds.empty();
+        if (jobs.empty() && !dependencies_changed && db.is_up_to_date(target, link.command)) {
+            db.save();
+            if (cache) cache->finish();
+            write_build_stamp(options, session, target, stamp_outputs);
+            std::cout << target << " is up to date." << std::endl;
+            return true;
+        }
+        jobs.push_back(link);
+        job_outputs.push_back({target, "", "", false, link_inputs});
+
+        bool ok = run_jobs(job_queue, options);
+        db.save();
+        if (cache) cache->finish();
+        write_dependency_stamps(jobs, session.dependency_builds, dependency_job_ends);
+        if (ok) {
+            session.dependencies_built = true;
+            write_build_stamp(options, session, target, stamp_outputs);
+        }
+        return ok;
+    }
+
+    // The body of Builder::build_workspace.
+    static bool run_workspace_build(const Config& root, const BuildOptions& options) {
+        Workspace workspace;
+        if (!Workspace::load(root, workspace)) return false;
+        if (workspace.members.empty()) {
+            std::cerr << "Error: [workspace] members lists no packages." << std::endl;
+            return false;
+        }
+
+        ToolchainInfo toolchain;
+        if (!Toolchain::detect(toolchain)) {
+            std::cerr << "Error: No suitable compiler (g++, clang++, cl) found in PATH.\n";
+            return false;
+        }
+        CompilerType type = toolchain.type;
+        const std::string& compiler_cmd = toolchain.command;
+
+        // One fetch and one mule.lock for what all members depend on outside the workspace
+        FetchOptions fetch_options;
+        fetch_options.offline = options.offline;
+        fetch_options.locked = options.locked;
+        std::vector<Dependency> resolved;
+        if (!PackageManager::fetch_dependencies(workspace.dependencies, fetch_options, resolved)) return false;
+        if (!options.locked) PackageManager::write_lockfile(resolved);
+        std::vector<MulePackage> packages;
+        if (!PackageManager::mule_packages(resolved, packages)) return false;
+        std::string build_type = dependency_build_type(options);
+        std::vector<DependencyBuild> dependency_builds =
+            PackageManager::dependency_builds(resolved, toolchain.identity(), root.standard, build_type,
+                                              options.jobs > 0 ? options.jobs : JobScheduler::default_jobs(), options.use_cache);
+        std::string common_flags = Builder::dependency_include_flags(type) + profile_flags(type, options);
+
+        // Static libraries end up inside shared ones, so one shared member makes everything PIC
+        bool pic = std::any_of(workspace.members.begin(), workspace.members.end(),
+                               [](const MulePackage& member) { return member.config.type == "shared-lib"; });
+
+        fs::create_directories("build");
+        BuildDb db;
+        db.load();
+        std::optional<CompileCache> cache;
+        if (options.use_cache) cache.emplace(toolchain.identity());
+        JobQueue queue{db, cache ? &*cache : nullptr, {}, {}};
+
+        std::vector<size_t> dependency_job_ends = queue_dependency_builds(queue, dependency_builds);
+        PackageLibraries libraries = queue_dependency_packages(queue, packages, type, compiler_cmd, common_flags, pic);
+        std::vector<size_t> dependency_jobs = libraries.jobs; // What every link waits for
+        for (size_t i = 0; i < (dependency_job_ends.empty() ? 0 : dependency_job_ends.back()); ++i) dependency_jobs.push_back(i);
+
+        // Members are ordered dependencies first, so everything a member needs is queued by
+        // the time it is reached
+        std::map<std::string, const MulePackage*> by_name;
+        std::map<std::string, std::set<std::string>> upstream; // Every member a member depends on, transitively
+        std::map<std::string, std::string> libraries_of;       // Library members -> the library they produce
+        std::map<std::string, size_t> final_jobs;              // Members -> the archive or link step, if it runs
+        for (const auto& member : workspace.members) {
+            by_name[member.name] = &member;
+            std::set<std::string>& reach = upstream[member.name];
+            for (const auto& dep : member.dependencies) {
+                reach.insert(dep);
+                reach.insert(upstream[dep].begin(), upstream[dep].end());
+            }
+            std::vector<MulePackage> upstream_members; // Dependencies first
+            for (const auto& other : workspace.members) {
+                if (reach.count(other.name)) upstream_members.push_back(other);
+            }
+
+            std::string flags = package_compile_flags(member, type);
+            for (const auto& other : upstream_members) flags += package_include_flags(other, type);
+            flags += common_flags;
+
+            const std::string& member_type = member.config.type;
+            PackageJobs compiled = queue_package_compiles(queue, member, package_sources(member, member_type == "bin"),
+                                                          fs::path("build") / "obj" / member.name, flags, type, compiler_cmd, pic);
+            if (compiled.objs.empty()) {
+                std::cerr << "Warning: workspace member " << member.name << " has no sources." << std::endl;
+                continue;
+            }
+            std::string target = get_target_path(type, member_type, member.name);
+
+            if (member_type == "static-lib") {
+                libraries_of[member.name] = target;
+                auto job = queue_archive(queue, type, "Archiving static library [lib" + member.name + "]...", compiled.objs, target, compiled.compile_jobs);
+                if (job) final_jobs[member.name] = *job;
+                continue;
+            }
+
+            // Linked as soon as its objects and the libraries it links against are done
+            Job link;
+            link.deps = compiled.compile_jobs;
+            link.deps.insert(link.deps.end(), dependency_jobs.begin(), dependency_jobs.end());
+            std::vector<std::string> link_inputs = compiled.objs;
+            for (auto it = upstream_members.rbegin(); it != upstream_members.rend(); ++it) {
+                auto library = libraries_of.find(it->name);
+                if (library == libraries_of.end()) continue;
+                link_inputs.push_back(library->second);
+                auto job = final_jobs.find(it->name);
+                if (job != final_jobs.end()) link.deps.push_back(job->second);
+            }
+            link_inputs.insert(link_inputs.end(), libraries.archives.begin(), libraries.archives.end());
+
+            Config link_config = member.config;
+            for (auto& dir : link_config.build.lib_dirs) dir = (fs::path(member.path) / dir).string();
+            add_package_link_flags(upstream_members, link_config);
+            add_package_link_flags(packages, link_config);
+            auto link_command = [=, &resolved]() {
+                Config config = link_config;
+                PackageManager::link_dependencies(resolved, build_type, config);
+                return make_link_cmd(type, compiler_cmd, link_inputs, target, config);
+            };
+            link.command = link_command();
+            if (!dependency_job_ends.empty()) link.prepare = [link_command](Job& job) { job.command = link_command(); };
+            link.description = std::string(member_type == "shared-lib" ? "Linking shared library [" : "Linking executable [") + member.name + "]...";
+            link.failure_message = "Linking failed for " + member.name;
+            link.response_file = target + ".rsp";
+            if (member_type == "shared-lib") libraries_of[member.name] = target;
+
+            // A rebuilt or restored dependency means a new library to link against
+            if (link.deps.empty() && dependency_builds.empty() && db.is_up_to_date(target, link.command)) continue;
+            queue.jobs.push_back(link);
+            queue.outputs.push_back({target, "", "", false, link_inputs});
+            final_jobs[member.name] = queue.jobs.size() - 1;
+        }
+
+        if (queue.jobs.empty()) {
+            db.save();
+            if (cache) cache->finish();
+            std::cout << "Workspace (" << workspace.members.size() << " members) is up to date." << std::endl;
+            return true;
+        }
+        bool ok = run_jobs(queue, options);
+        db.save();
+        if (cache) cache->finish();
+        write_dependency_stamps(queue.jobs, dependency_builds, dependency_job_ends);
+        return ok;
+    }
+
+    bool Builder::build_workspace(const Config& root, const BuildOptions& options) {
+        Jobserver::init(options.jobs > 0 ? options.jobs : JobScheduler::default_jobs());
+        if (options.timings) Timings::begin();
+        bool ok = run_workspace_build(root, options);
+        Timings::finish(ok);
+        return ok;
+    }
+
+    static const char* UNIT_TEST_MAIN =
+        "#include \"include/mule_test.h\"\n"
+        "#include <iostream>\n"
+        "int main() {\n"
+        "    int passed = 0; int failed = 0;\n"
+        "    for (const auto& test : mule::get_tests()) {\n"
+        "        try { test.func(); std::cout << \"  [PASS] \" << test.name << std::endl; passed++; }\n"
+        "        catch (const std::exception& e) { std::cout << \"  [FAIL] \" << test.name << \": \" << e.what() << std::endl; failed++; }\n"
+        "    }\n"
+        "    return failed;\n"
+        "}\n";
+
+    // The body of Builder::build_tests.
+    static bool run_test_build(const Config& config, const BuildOptions& options, std::vector<TestBinary>& out) {
+        out.clear();
+        std::vector<std::string> lib_sources, unit_test_sources, integration_test_sources;
+        if (fs::exists("src")) {
+            for (const auto& entry : fs::recursive_directory_iterator("src")) {
+                if (entry.path().extension() != ".cpp") continue;
+                std::string filename = entry.path().filename().string();
+                if (filename == "main.cpp") continue;
+                if (filename.find("_test.cpp") != std::string::npos) {
+                    unit_test_sources.push_back(entry.path().string());
+                } else {
+                    lib_sources.push_back(entry.path().string());
+                }
+            }
+        }
+        if (fs::exists("tests")) {
+            for (const auto& entry : fs::directory_iterator("tests")) {
+                if (entry.path().extension() == ".cpp") integration_test_sources.push_back(entry.path().string());
+            }
+        }
+        std::sort(lib_sources.begin(), lib_sources.end());
+        std::sort(unit_test_sources.begin(), unit_test_sources.end());
+        std::sort(integration_test_sources.begin(), integration_test_sources.end());
+        if (unit_test_sources.empty() && integration_test_sources.empty()) return true;
+
+        BuildSession session;
+        if (!prepare_session(config, options, session)) return false;
+        CompilerType compiler_type = session.compiler_type;
+        const std::string& compiler_cmd = session.compiler_cmd;
+        const Config& active_config = session.active_config;
+        bool is_shared = active_config.type == "shared-lib";
+
+        fs::create_directories("build/tests");
+        BuildDb db;
+        db.load();
+        std::optional<CompileCache> cache;
+        if (options.use_cache) cache.emplace(session.compiler_identity);
+
+        // The flags run_build compiles the project with, so library objects mule build made
+        // are up to date here and the other way round
+        std::string include_flags = Builder::compile_flags(active_config, compiler_type) + session.dependency_flags + profile_flags(compiler_type, options);
+        bool dependencies_first = !active_config.build.pch.empty();
+        if (dependencies_first && !run_dependency_builds(db, session.dependency_builds, options)) {
+            db.save();
+            return false;
         }
+        PrecompiledHeader pch;
+        if (!Builder::prepare_pch(active_config, compiler_type, compiler_cmd, include_flags, db, pch)) {
+            db.save();
+            return false;
+        }
+        std::string cxx_flags = include_flags + pch.compile_flags;
+        std::string test_flags = cxx_flags + (compiler_type == CompilerType::MSVC ? "/I. " : "-I. "); // For include/mule_test.h
+        std::string obj_ext = get_obj_extension(compiler_type);
+
+        JobQueue queue{db, cache ? &*cache : nullptr, {}, {}};
+        std::vector<size_t> dependency_job_ends;
+        if (!dependencies_first) dependency_job_ends = queue_dependency_builds(queue, session.dependency_builds);
+        PackageLibraries packages = queue_dependency_packages(queue, session.packages, compiler_type, compiler_cmd,
+                                                              session.dependency_flags + profile_flags(compiler_type, options), is_shared);
+        std::vector<size_t> link_deps = packages.jobs; // What every test link waits for besides its own objects
+        for (size_t i = 0; i < (dependency_job_ends.empty() ? 0 : dependency_job_ends.back()); ++i) link_deps.push_back(i);
+
+        auto queue_compile = [&](const std::string& src, const fs::path& obj_path, const std::string& description, const std::string& flags,
+                                 std::vector<std::string>& objs, std::vector<size_t>& jobs) {
+            Job job;
+            job.description = description + fs::path(src).filename().string();
+            job.command = make_compile_cmd(compiler_type, compiler_cmd, src, obj_path.string(), active_config.standard, flags, is_shared);
+            job.failure_message = "Compilation failed for " + src;
+            job.response_file = obj_path.string() + ".rsp";
+            objs.push_back(obj_path.string());
+            if (queue.queue(job, {obj_path.string(), DepTracker::depfile_path(obj_path.string(), compiler_type), src, true, pch.inputs})) {
+                jobs.push_back(queue.jobs.size() - 1);
+            }
+        };
 
-        if (std::system(link_cmd.c_str()) != 0) {
-             std::cerr << "Linking/Archiving failed." << std::endl;
+        // The library sources compile once, into the objects mule build uses, and are
+        // archived for every test binary to link against
+        std::vector<std::string> archives;
+        if (!lib_sources.empty()) {
+            std::vector<std::string> lib_objs;
+            std::vector<size_t> lib_jobs;
+            for (const auto& src : lib_sources) {
+                queue_compile(src, fs::path("build") / fs::path(src).filename().replace_extension(obj_ext), "Compiling: ", cxx_flags, lib_objs, lib_jobs);
+            }
+            std::string archive = (fs::path("build/tests") / fs::path(get_target_path(compiler_type, "static-lib", active_config.project_name + "_lib")).filename()).string();
+            auto job = queue_archive(queue, compiler_type, "Archiving test library [" + active_config.project_name + "]...", lib_objs, archive, lib_jobs);
+            if (job) link_deps.push_back(*job);
+            archives.push_back(archive);
         }
+        archives.insert(archives.end(), packages.archives.begin(), packages.archives.end());
+
+        Config link_config = active_config;
+        link_config.type = "bin";
+        if (link_config.cuda.enabled) {
+            #ifdef _WIN32
+                link_config.build.libs.push_back("cudart");
+            #else
+                link_config.build.linker_flags.push_back("-lcudart");
+            #endif
+        }
+        add_package_link_flags(session.packages, link_config);
+        std::string build_type = dependency_build_type(options);
+
+        std::vector<std::optional<size_t>> link_jobs; // Parallel to out
+        auto queue_test = [&](const std::string& name, const std::string& output, const std::vector<std::string>& sources, const fs::path& obj_dir) {
+            fs::create_directories(obj_dir);
+            Job link;
+            link.deps = link_deps;
+            std::vector<std::string> link_inputs;
+            for (const auto& src : sources) {
+                queue_compile(src, obj_dir / fs::path(src).filename().replace_extension(obj_ext), "Compiling test: ", test_flags, link_inputs, link.deps);
+            }
+            // MSVC: every object compiled with /Yu needs the PCH's object
+            if (!pch.object.empty()) link_inputs.push_back(pch.object);
+            link_inputs.insert(link_inputs.end(), archives.begin(), archives.end());
+
+            const std::vector<Dependency>& dependencies = session.dependencies;
+            auto link_command = [=, &dependencies]() {
+                Config config = link_config;
+                PackageManager::link_dependencies(dependencies, build_type, config);
+                return make_link_cmd(compiler_type, compiler_cmd, link_inputs, output, config);
+            };
+            link.command = link_command();
+            if (!dependency_job_ends.empty()) link.prepare = [link_command](Job& job) { job.command = link_command(); };
+            link.description = "Linking test [" + name + "]...";
+            link.failure_message = "Linking failed for test " + name;
+            link.response_file = output + ".rsp";
+            out.push_back({name, output, true});
+
+            // A rebuilt or restored dependency means a new library to link against
+            if (link.deps.empty() && session.dependency_builds.empty() && db.is_up_to_date(output, link.command)) {
+                link_jobs.push_back(std::nullopt);
+                return;
+            }
+            queue.jobs.push_back(link);
+            queue.outputs.push_back({output, "", "", false, link_inputs});
+            link_jobs.push_back(queue.jobs.size() - 1);
+        };
+
+        if (!unit_test_sources.empty()) {
+            std::string main_path = "build/unit_test_main.cpp";
+            std::ifstream existing(main_path);
+            std::string existing_content((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+            existing.close();
+            if (existing_content != UNIT_TEST_MAIN) std::ofstream(main_path) << UNIT_TEST_MAIN;
+            std::vector<std::string> sources = {main_path};
+            sources.insert(sources.end(), unit_test_sources.begin(), unit_test_sources.end());
+            queue_test("unit_tests", "build/unit_tests" + get_exe_ext(), sources, "build/tests/unit");
+        }
+        for (const auto& src : integration_test_sources) {
+            std::string name = fs::path(src).stem().string();
+            queue_test(name, "build/test_" + name + get_exe_ext(), {src}, fs::path("build/tests") / name);
+        }
+
+        bool ok = true;
+        if (!queue.jobs.empty()) ok = run_jobs(queue, options);
+        db.save();
+        if (cache) cache->finish();
+        write_dependency_stamps(queue.jobs, session.dependency_builds, dependency_job_ends);
+        for (size_t i = 0; i < out.size(); ++i) {
+            if (link_jobs[i]) out[i].built = queue.jobs[*link_jobs[i]].status == JobStatus::Succeeded;
+        }
+        return ok || std::any_of(out.begin(), out.end(), [](const TestBinary& test) { return test.built; });
+    }
+
+    bool Builder::build_tests(const Config& config, const BuildOptions& options, std::vector<TestBinary>& out) {
+        Jobserver::init(options.jobs > 0 ? options.jobs : JobScheduler::default_jobs());
+        if (options.timings) Timings::begin();
+        bool ok = run_test_build(config, options, out);
+        Timings::finish(ok);
+        return ok;
+    }
+
+    bool Builder::build(const Config& config, const BuildOptions& options, BuildSession& session) {
+        Jobserver::init(options.jobs > 0 ? options.jobs : JobScheduler::default_jobs());
+        if (options.timings) Timings::begin();
+        bool ok = run_build(config, options, session);
+        Timings::finish(ok);
+        return ok;
     }
 
-    void Builder::run(const Config& config) {
+    void Builder::run(const Config& config, const BuildOptions& options) {
         // Ensure build
-        build(config);
+        if (!build(config, options)) {
+            std::cerr << "Build failed, cannot run." << std::endl;
+            return;
+        }
+        run_binary(config);
+    }
 
+    void Builder::run_binary(const Config& config) {
         std::string bin_name = config.project_name;
         if(bin_name.empty()) bin_name = "app"; 
         
@@ -407,7 +1531,9 @@ namespace mule {
     #ifdef _WIN32
             run_cmd = bin_path.string();
     #endif
-            std::system(run_cmd.c_str());
+            ProcessOptions run_options;
+            run_options.capture = false;
+            Process::run(std::vector<std::string>{run_cmd}, run_options);
         } else {
             std::cerr << "Build failed, cannot run." << std::endl;
         }
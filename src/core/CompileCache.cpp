@@ -0,0 +1,336 @@
+#include "../../include/core/CompileCache.h"
+#include "../../include/core/DepTracker.h"
+#include "../../include/core/Utils.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    static const size_t MAX_MANIFEST_ENTRIES = 16;
+    static const uint64_t DEFAULT_MAX_SIZE = 5ULL * 1024 * 1024 * 1024;
+
+    struct ManifestEntry {
+        uint64_t result_key = 0;
+        std::vector<std::pair<std::string, uint64_t>> files; // Included file -> content hash
+    };
+
+    struct CacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t size = 0;
+    };
+
+    static fs::path entry_path(const std::string& dir, const std::string& kind, uint64_t key, const std::string& ext) {
+        std::string hex = to_hex(key);
+        return fs::path(dir) / kind / hex.substr(0, 2) / (hex + ext);
+    }
+
+    static std::string unique_suffix() {
+        return ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    // Copies src to dest through a temporary file so concurrent readers never see a partial file.
+    static bool copy_atomic(const fs::path& src, const fs::path& dest) {
+        std::error_code ec;
+        fs::create_directories(dest.parent_path(), ec);
+        fs::path tmp = dest.string() + unique_suffix();
+        fs::copy_file(src, tmp, fs::copy_options::overwrite_existing, ec);
+        if (ec) return false;
+        fs::rename(tmp, dest, ec);
+        if (ec) {
+            fs::remove(tmp, ec);
+            return false;
+        }
+        return true;
+    }
+
+    static void touch(const fs::path& path) {
+        std::error_code ec;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    }
+
+    static uint64_t max_cache_size() {
+        const char* env = std::getenv("MULE_CACHE_SIZE");
+        uint64_t bytes;
+        return env && parse_size(env, bytes) ? bytes : DEFAULT_MAX_SIZE;
+    }
+
+    static std::string format_size(uint64_t bytes) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        if (bytes >= 1024ULL * 1024 * 1024) ss << bytes / (1024.0 * 1024 * 1024) << " GB";
+        else if (bytes >= 1024ULL * 1024) ss << bytes / (1024.0 * 1024) << " MB";
+        else ss << bytes / 1024.0 << " KB";
+        return ss.str();
+    }
+
+    static CacheStats read_stats(const std::string& dir) {
+        CacheStats stats;
+        std::ifstream in(fs::path(dir) / "stats");
+        std::string key;
+        uint64_t value;
+        while (in >> key >> value) {
+            if (key == "hits") stats.hits = value;
+            else if (key == "misses") stats.misses = value;
+            else if (key == "size") stats.size = value;
+        }
+        return stats;
+    }
+
+    static void write_stats(const std::string& dir, const CacheStats& stats) {
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        fs::path path = fs::path(dir) / "stats";
+        fs::path tmp = path.string() + unique_suffix();
+        {
+            std::ofstream out(tmp);
+            out << "hits " << stats.hits << "\n"
+                << "misses " << stats.misses << "\n"
+                << "size " << stats.size << "\n";
+        }
+        fs::rename(tmp, path, ec);
+    }
+
+    // Text format: "entry <result_key> <count>" followed by count "<hash> <path>" lines.
+    static std::vector<ManifestEntry> read_manifest(const fs::path& path) {
+        std::vector<ManifestEntry> entries;
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream header(line);
+            std::string tag;
+            ManifestEntry entry;
+            size_t count = 0;
+            if (!(header >> tag >> std::hex >> entry.result_key >> std::dec >> count) || tag != "entry") break;
+            for (size_t i = 0; i < count && std::getline(in, line); ++i) {
+                size_t space = line.find(' ');
+                if (space == std::string::npos) break;
+                entry.files.emplace_back(line.substr(space + 1), std::stoull(line.substr(0, space), nullptr, 16));
+            }
+            if (entry.files.size() == count) entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    static void write_manifest(const fs::path& path, const std::vector<ManifestEntry>& entries) {
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        fs::path tmp = path.string() + unique_suffix();
+        {
+            std::ofstream out(tmp);
+            for (const auto& entry : entries) {
+                out << "entry " << to_hex(entry.result_key) << " " << entry.files.size() << "\n";
+                for (const auto& [file, hash] : entry.files) out << to_hex(hash) << " " << file << "\n";
+            }
+        }
+        fs::rename(tmp, path, ec);
+    }
+
+    CompileCache::CompileCache(const std::string& compiler_identity)
+        : dir_(cache_dir()), identity_(compiler_identity), cwd_(fs::current_path().string()) {}
+
+    std::string CompileCache::cache_dir() {
+        if (const char* dir = std::getenv("MULE_CACHE_DIR")) return dir;
+        if (const char* xdg = std::getenv("XDG_CACHE_HOME")) return (fs::path(xdg) / "mule").string();
+#ifdef _WIN32
+        const char* home = std::getenv("LOCALAPPDATA");
+#else
+        const char* home = std::getenv("HOME");
+#endif
+        if (!home) return (fs::temp_directory_path() / "mule-cache").string();
+        return (fs::path(home) / ".cache" / "mule").string();
+    }
+
+    bool CompileCache::manifest_key(BuildDb& db, const std::string& command, const std::string& src, uint64_t& out_key) {
+        uint64_t src_hash;
+        if (!db.file_hash(src, src_hash)) return false;
+
+        // Checkout-independent: the working directory never takes part in the key
+        std::string normalized = command;
+        size_t pos = 0;
+        while (!cwd_.empty() && (pos = normalized.find(cwd_, pos)) != std::string::npos) {
+            normalized.replace(pos, cwd_.size(), ".");
+            pos += 1;
+        }
+
+        uint64_t key = hash_string(identity_);
+        key = hash_string(normalized, key);
+        key = hash_string(src, key);
+        key = hash_string(to_hex(src_hash), key);
+        out_key = key;
+        return true;
+    }
+
+    bool CompileCache::fetch(BuildDb& db, const std::string& command, const std::string& src,
+                             const std::string& obj, const std::string& depfile) {
+        uint64_t key;
+        if (!manifest_key(db, command, src, key)) {
+            ++misses_;
+            return false;
+        }
+
+        fs::path manifest = entry_path(dir_, "manifests", key, ".manifest");
+        std::string obj_ext = fs::path(obj).extension().string();
+
+        for (const auto& entry : read_manifest(manifest)) {
+            bool matches = true;
+            for (const auto& [file, hash] : entry.files) {
+                uint64_t current;
+                if (!db.file_hash(file, current) || current != hash) {
+                    matches = false;
+                    break;
+                }
+            }
+            if (!matches) continue;
+
+            fs::path cached_obj = entry_path(dir_, "objects", entry.result_key, obj_ext);
+            fs::path cached_dep = entry_path(dir_, "objects", entry.result_key, ".d");
+            if (!fs::exists(cached_obj) || !fs::exists(cached_dep)) continue;
+
+            if (!copy_atomic(cached_obj, obj) || !copy_atomic(cached_dep, depfile)) continue;
+            // Eviction must not split the object from its depfile
+            touch(cached_obj);
+            touch(cached_dep);
+            touch(manifest);
+            ++hits_;
+            return true;
+        }
+
+        ++misses_;
+        return false;
+    }
+
+    void CompileCache::store(BuildDb& db, const std::string& command, const std::string& src,
+                             const std::string& obj, const std::string& depfile,
+                             const std::vector<std::string>& extra_inputs) {
+        uint64_t key;
+        if (!manifest_key(db, command, src, key)) return;
+
+        ManifestEntry entry;
+        uint64_t result_key = key;
+        std::vector<std::string> inputs = DepTracker::parse_depfile(depfile);
+        inputs.insert(inputs.end(), extra_inputs.begin(), extra_inputs.end());
+        for (const auto& file : inputs) {
+            uint64_t hash;
+            if (!db.file_hash(file, hash)) return;
+            entry.files.emplace_back(file, hash);
+            result_key = hash_string(file, result_key);
+            result_key = hash_string(to_hex(hash), result_key);
+        }
+        if (entry.files.empty()) return;
+        entry.result_key = result_key;
+
+        std::string obj_ext = fs::path(obj).extension().string();
+        fs::path cached_obj = entry_path(dir_, "objects", result_key, obj_ext);
+        fs::path cached_dep = entry_path(dir_, "objects", result_key, ".d");
+        if (!copy_atomic(obj, cached_obj) || !copy_atomic(depfile, cached_dep)) return;
+
+        std::error_code ec;
+        added_bytes_ += fs::file_size(cached_obj, ec) + fs::file_size(cached_dep, ec);
+
+        fs::path manifest = entry_path(dir_, "manifests", key, ".manifest");
+        std::vector<ManifestEntry> entries = read_manifest(manifest);
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const ManifestEntry& e) {
+            return e.result_key == result_key;
+        }), entries.end());
+        entries.insert(entries.begin(), entry);
+        if (entries.size() > MAX_MANIFEST_ENTRIES) entries.resize(MAX_MANIFEST_ENTRIES);
+        write_manifest(manifest, entries);
+    }
+
+    // Adds counters to the stats file and, once the cache outgrew its limit, evicts least
+    // recently used objects, manifests and artifacts until it is back at 90% of it.
+    static void update_stats(const std::string& dir, uint64_t hits, uint64_t misses, uint64_t added_bytes) {
+        // Other mule processes sharing the cache update the same counters
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        FileLock lock((fs::path(dir) / "stats.lock").string());
+        CacheStats stats = read_stats(dir);
+        stats.hits += hits;
+        stats.misses += misses;
+        stats.size += added_bytes;
+
+        uint64_t max_size = max_cache_size();
+        if (stats.size > max_size) {
+            // Hits refresh the mtime of the files they read, artifact restores that of the
+            // entry's prefix file. An artifact is evicted as a whole.
+            struct CachedEntry { fs::file_time_type mtime; uint64_t size; fs::path path; };
+            std::vector<CachedEntry> entries;
+            uint64_t total = 0;
+            for (const char* kind : {"objects", "manifests"}) {
+                fs::path root = fs::path(dir) / kind;
+                if (!fs::exists(root)) continue;
+                for (const auto& entry : fs::recursive_directory_iterator(root, ec)) {
+                    if (!entry.is_regular_file(ec)) continue;
+                    CachedEntry file{entry.last_write_time(ec), entry.file_size(ec), entry.path()};
+                    total += file.size;
+                    entries.push_back(file);
+                }
+            }
+            for (const auto& artifact : fs::directory_iterator(fs::path(dir) / "artifacts", ec)) {
+                // Skip stores still in progress
+                if (!artifact.is_directory(ec) || artifact.path().filename().string().find(".tmp") != std::string::npos) continue;
+                CachedEntry entry{fs::last_write_time(artifact.path() / "prefix", ec), 0, artifact.path()};
+                if (ec) entry.mtime = fs::file_time_type::min();
+                for (const auto& file : fs::recursive_directory_iterator(artifact.path(), ec)) {
+                    if (file.is_regular_file(ec) && !file.is_symlink(ec)) entry.size += file.file_size(ec);
+                }
+                total += entry.size;
+                entries.push_back(entry);
+            }
+            std::sort(entries.begin(), entries.end(), [](const CachedEntry& a, const CachedEntry& b) {
+                return a.mtime < b.mtime;
+            });
+
+            uint64_t target = max_size / 10 * 9;
+            for (const auto& entry : entries) {
+                if (total <= target) break;
+                if (fs::remove_all(entry.path, ec) > 0) total -= entry.size;
+            }
+            stats.size = total;
+        }
+        write_stats(dir, stats);
+    }
+
+    void CompileCache::finish() {
+        if (hits_ == 0 && misses_ == 0 && added_bytes_ == 0) return;
+        update_stats(dir_, hits_, misses_, added_bytes_);
+        hits_ = misses_ = added_bytes_ = 0;
+    }
+
+    void CompileCache::add_size(uint64_t bytes) {
+        if (bytes > 0) update_stats(cache_dir(), 0, 0, bytes);
+    }
+
+    void CompileCache::print_stats() {
+        std::string dir = cache_dir();
+        CacheStats stats = read_stats(dir);
+        uint64_t lookups = stats.hits + stats.misses;
+        double rate = lookups == 0 ? 0.0 : 100.0 * stats.hits / lookups;
+
+        std::cout << "Cache directory: " << dir << "\n"
+                  << "Hits:            " << stats.hits << "\n"
+                  << "Misses:          " << stats.misses << "\n"
+                  << "Hit rate:        " << std::fixed << std::setprecision(1) << rate << "%\n"
+                  << "Size:            " << format_size(stats.size) << " / " << format_size(max_cache_size()) << std::endl;
+    }
+
+    void CompileCache::clear() {
+        std::string dir = cache_dir();
+        std::error_code ec;
+        fs::remove_all(fs::path(dir) / "objects", ec);
+        fs::remove_all(fs::path(dir) / "manifests", ec);
+        fs::remove_all(fs::path(dir) / "artifacts", ec);
+        FileLock lock((fs::path(dir) / "stats.lock").string());
+        write_stats(dir, CacheStats{});
+        std::cout << "Cleared compile and artifact cache at " << dir << std::endl;
+    }
+}
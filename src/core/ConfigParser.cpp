@@ -3,6 +3,7 @@
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
@@ -14,6 +15,10 @@ namespace mule {
         std::ifstream file(filename);
         std::string line;
         std::string current_section = "default";
+        int line_no = 0;
+        auto malformed = [&](const std::string& what) {
+            return std::runtime_error(filename + ":" + std::to_string(line_no) + ": " + what);
+        };
 
         if (!fs::exists(filename)) {
             std::cerr << "Error: Configuration file '" << filename << "' not found.\n"
@@ -21,29 +26,33 @@ namespace mule {
             std::exit(1); 
         }
 
-        while (std::getline(file, line)) {
-            //  Basic cleaning
-            line.erase(0, line.find_first_not_of(" \t\r\n"));
-            line.erase(line.find_last_not_of(" \t\r\n") + 1);
-
-            if (line.empty() || line[0] == '#')
-                continue;
-
-            // Strip inline comments (basic quote-aware)
+        // Strip inline comments (basic quote-aware)
+        auto strip_comment = [](std::string& text) {
             bool in_quotes = false;
             size_t comment_pos = std::string::npos;
-            for (size_t i = 0; i < line.size(); ++i) {
-                if (line[i] == '\"') in_quotes = !in_quotes;
-                if (line[i] == '#' && !in_quotes) {
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] == '\"') in_quotes = !in_quotes;
+                if (text[i] == '#' && !in_quotes) {
                     comment_pos = i;
                     break;
                 }
             }
             if (comment_pos != std::string::npos) {
-                line = line.substr(0, comment_pos);
-                line.erase(line.find_last_not_of(" \t\r\n") + 1);
+                text = text.substr(0, comment_pos);
+                text.erase(text.find_last_not_of(" \t\r\n") + 1);
             }
+        };
 
+        while (std::getline(file, line)) {
+            ++line_no;
+            //  Basic cleaning
+            line.erase(0, line.find_first_not_of(" \t\r\n"));
+            line.erase(line.find_last_not_of(" \t\r\n") + 1);
+
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            strip_comment(line);
             if (line.empty()) continue;
 
             //  Detect Section [[section_name]] (Array of Tables)
@@ -65,15 +74,35 @@ namespace mule {
             //  Detect Key-Value Pairs
             size_t delim = line.find('=');
             if (delim != std::string::npos) {
+                // Arrays may span several lines, e.g. a long workspace members list
+                size_t open = line.find_first_not_of(" \t", delim + 1);
+                if (open != std::string::npos && line[open] == '[' && line.find(']', open) == std::string::npos) {
+                    std::string next;
+                    bool closed = false;
+                    while (!closed && std::getline(file, next)) {
+                        ++line_no;
+                        next.erase(0, next.find_first_not_of(" \t\r\n"));
+                        strip_comment(next);
+                        next.erase(next.find_last_not_of(" \t\r\n") + 1);
+                        line += next;
+                        closed = next.find(']') != std::string::npos;
+                    }
+                    if (!closed) throw malformed("unterminated array");
+                }
                 std::string key = line.substr(0, delim);
                 std::string val = line.substr(delim + 1);
 
                 // Clean key whitespace
                 key.erase(std::remove(key.begin(), key.end(), ' '), key.end());
+                if (key.empty()) throw malformed("missing key before '='");
                 
                 // Clean value leading/trailing whitespace and quotes
                 val.erase(0, val.find_first_not_of(" \t\r\n"));
                 val.erase(val.find_last_not_of(" \t\r\n") + 1);
+                if (!val.empty() && (val.front() == '\"' || val.front() == '\'') && (val.size() < 2 || val.back() != val.front())) {
+                    throw malformed("unterminated string");
+                }
+                if (!val.empty() && val.front() == '{' && val.back() != '}') throw malformed("unterminated inline table");
                 if (!val.empty() && (val.front() == '\"' || val.front() == '\'')) val.erase(0, 1);
                 if (!val.empty() && (val.back() == '\"' || val.back() == '\'')) val.pop_back();
 
@@ -96,6 +125,8 @@ namespace mule {
                 val = unescaped;
 
                 raw_config[current_section][key] = val;
+            } else {
+                throw malformed("expected [section] or key = value");
             }
         }
 
@@ -137,6 +168,20 @@ namespace mule {
             if (bld.count("flags")) config.build.flags = parse_list(bld["flags"]);
             if (bld.count("linker_flags")) config.build.linker_flags = parse_list(bld["linker_flags"]);
             if (bld.count("defines")) config.build.defines = parse_list(bld["defines"]);
+            if (bld.count("pch")) config.build.pch = bld["pch"];
+            if (bld.count("unity_batch")) {
+                try {
+                    config.build.unity_batch = std::stoi(bld["unity_batch"]);
+                } catch (...) {
+                    std::cerr << "Warning: ignoring invalid unity_batch '" << bld["unity_batch"] << "'.\n";
+                }
+            }
+            if (bld.count("unity_exclude")) config.build.unity_exclude = parse_list(bld["unity_exclude"]);
+        }
+
+        if (raw_config.count("workspace")) {
+            auto& ws = raw_config["workspace"];
+            if (ws.count("members")) config.workspace.members = parse_list(ws["members"]);
         }
 
         if (raw_config.count("qt")) {
@@ -205,6 +250,7 @@ namespace mule {
             for (const auto& [name, val] : raw_config["dependencies"]) {
                 Dependency dep;
                 dep.name = name;
+                if (val.empty()) throw std::runtime_error(filename + ": dependency '" + name + "' has no source");
 
                 if (val.front() == '{' && val.back() == '}') {
                     // Parse inline table: { git = "...", tag = "..." }
@@ -231,6 +277,8 @@ namespace mule {
                         if (k == "tag") dep.tag = v;
                         if (k == "commit") dep.commit = v;
                         if (k == "path") dep.path = v;
+                        if (k == "subdir") dep.subdir = v;
+                        if (k == "version") dep.version = v;
                         
                         pos = comma + 1;
                     }
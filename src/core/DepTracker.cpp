@@ -0,0 +1,130 @@
+#include "../../include/core/DepTracker.h"
+#include "../../include/core/Process.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cctype>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    static std::string read_file(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }
+
+    static bool is_module_pseudo_target(const std::string& name) {
+        // GCC's -fmodules-ts depfiles name modules as phony "<module>.c++m" targets
+        return name.size() > 5 && name.compare(name.size() - 5, 5, ".c++m") == 0;
+    }
+
+    // Make syntax as written by GCC, Clang and nvcc: "target: dep dep", continued over
+    // lines with a trailing backslash, spaces inside paths escaped as "\ " and '$' as "$$".
+    static std::vector<std::string> parse_make_deps(const std::string& content) {
+        std::vector<std::string> deps;
+        std::string token;
+        bool in_target = true;
+        bool skip_rule = false;
+
+        auto flush = [&]() {
+            if (token.empty()) return;
+            if (in_target) {
+                if (token == ".PHONY" || is_module_pseudo_target(token)) skip_rule = true;
+            } else if (!skip_rule && !is_module_pseudo_target(token)) {
+                deps.push_back(token);
+            }
+            token.clear();
+        };
+
+        for (size_t i = 0; i < content.size(); ++i) {
+            char c = content[i];
+            if (c == '\\' && i + 1 < content.size()) {
+                char next = content[i + 1];
+                if (next == '\n' || next == '\r') {
+                    // Line continuation
+                    flush();
+                    ++i;
+                    if (next == '\r' && i + 1 < content.size() && content[i + 1] == '\n') ++i;
+                    continue;
+                }
+                if (next == ' ' || next == '#' || next == '\\') {
+                    token += next;
+                    ++i;
+                    continue;
+                }
+                token += c;
+            } else if (c == '$' && i + 1 < content.size() && content[i + 1] == '$') {
+                token += '$';
+                ++i;
+            } else if (c == ':' && in_target && (i + 1 >= content.size() || isspace(static_cast<unsigned char>(content[i + 1])))) {
+                // End of the target list (a drive letter like "C:\" is not followed by a space)
+                flush();
+                in_target = false;
+            } else if (c == '\n') {
+                flush();
+                in_target = true;
+                skip_rule = false;
+            } else if (isspace(static_cast<unsigned char>(c))) {
+                flush();
+            } else {
+                token += c;
+            }
+        }
+        flush();
+        return deps;
+    }
+
+    // MSVC: {"Version": "1.1", "Data": {"Source": "...", "Includes": ["...", ...]}}
+    static std::vector<std::string> parse_msvc_deps(const std::string& content) {
+        std::vector<std::string> deps;
+
+        auto read_string = [&](size_t& pos) {
+            std::string value;
+            for (++pos; pos < content.size() && content[pos] != '"'; ++pos) {
+                if (content[pos] == '\\' && pos + 1 < content.size()) ++pos;
+                value += content[pos];
+            }
+            return value;
+        };
+
+        size_t pos = content.find("\"Source\"");
+        if (pos != std::string::npos) {
+            pos = content.find('"', content.find(':', pos));
+            if (pos != std::string::npos) deps.push_back(read_string(pos));
+        }
+
+        pos = content.find("\"Includes\"");
+        if (pos == std::string::npos) return deps;
+        pos = content.find('[', pos);
+        while (pos != std::string::npos && pos < content.size() && content[pos] != ']') {
+            if (content[pos] == '"') {
+                deps.push_back(read_string(pos));
+            }
+            ++pos;
+        }
+        return deps;
+    }
+
+    std::string DepTracker::depfile_path(const std::string& obj, CompilerType type) {
+        fs::path path = obj;
+        return path.replace_extension(type == CompilerType::MSVC ? ".d.json" : ".d").string();
+    }
+
+    std::string DepTracker::depfile_flags(const std::string& depfile, CompilerType type) {
+        if (type == CompilerType::MSVC) {
+            return "/sourceDependencies " + Process::quote(depfile) + " ";
+        }
+        return "-MMD -MF " + Process::quote(depfile) + " ";
+    }
+
+    std::vector<std::string> DepTracker::parse_depfile(const std::string& depfile) {
+        std::string content = read_file(depfile);
+        if (fs::path(depfile).extension() == ".json") {
+            return parse_msvc_deps(content);
+        }
+        return parse_make_deps(content);
+    }
+}
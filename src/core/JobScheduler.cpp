@@ -0,0 +1,223 @@
+#include "../../include/core/JobScheduler.h"
+#include "../../include/core/Process.h"
+#include "../../include/core/Jobserver.h"
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace mule {
+
+    int JobScheduler::default_jobs() {
+        unsigned int n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : static_cast<int>(n);
+    }
+
+    long JobScheduler::default_memory_budget_kb() {
+#ifdef __linux__
+        std::ifstream meminfo("/proc/meminfo");
+        std::string line;
+        while (std::getline(meminfo, line)) {
+            if (line.rfind("MemAvailable:", 0) != 0) continue;
+            std::istringstream fields(line.substr(13));
+            long available_kb = 0;
+            fields >> available_kb;
+            return available_kb / 10 * 8;
+        }
+#endif
+        return 0;
+    }
+
+    // Longest estimated time from the start of each job to the end of the graph (its own
+    // estimate plus the most expensive chain of jobs waiting on it).
+    static std::vector<double> critical_path_lengths(const std::vector<Job>& jobs) {
+        std::vector<std::vector<size_t>> dependents(jobs.size());
+        std::vector<size_t> pending(jobs.size(), 0);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            pending[i] = jobs[i].deps.size();
+            for (size_t dep : jobs[i].deps) dependents[dep].push_back(i);
+        }
+        // Topological order, then walk it backwards
+        std::vector<size_t> order;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (pending[i] == 0) order.push_back(i);
+        }
+        for (size_t k = 0; k < order.size(); ++k) {
+            for (size_t next : dependents[order[k]]) {
+                if (--pending[next] == 0) order.push_back(next);
+            }
+        }
+        std::vector<double> length(jobs.size(), 0);
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            double longest_after = 0;
+            for (size_t next : dependents[*it]) longest_after = std::max(longest_after, length[next]);
+            length[*it] = jobs[*it].estimate_ms + longest_after;
+        }
+        return length;
+    }
+
+    namespace {
+        // Ready jobs ordered by priority, ties broken by the order they were added
+        struct ReadyOrder {
+            const std::vector<double>* priority;
+            bool operator()(size_t a, size_t b) const {
+                if ((*priority)[a] != (*priority)[b]) return (*priority)[a] > (*priority)[b];
+                return a < b;
+            }
+        };
+        using ReadySet = std::set<size_t, ReadyOrder>;
+    }
+
+    // Best ready job whose expected memory fits into what is still free. When nothing is
+    // running the best job is taken regardless, so one that exceeds the budget still runs.
+    static bool pick_job(const ReadySet& ready, const std::vector<Job>& jobs, long memory_budget_kb, long memory_in_use_kb, int running, size_t& out) {
+        if (ready.empty()) return false;
+        if (memory_budget_kb <= 0 || running == 0) {
+            out = *ready.begin();
+            return true;
+        }
+        for (size_t id : ready) {
+            if (memory_in_use_kb + jobs[id].memory_kb <= memory_budget_kb) {
+                out = id;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double JobScheduler::predict_makespan(const std::vector<Job>& jobs, int max_jobs, long memory_budget_kb, bool critical_path_first) {
+        if (jobs.empty()) return 0;
+        if (max_jobs <= 0) max_jobs = default_jobs();
+
+        std::vector<double> priority = critical_path_first ? critical_path_lengths(jobs) : std::vector<double>(jobs.size(), 0);
+        ReadySet ready(ReadyOrder{&priority});
+        std::vector<size_t> remaining_deps(jobs.size(), 0);
+        std::vector<std::vector<size_t>> dependents(jobs.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            remaining_deps[i] = jobs[i].deps.size();
+            for (size_t dep : jobs[i].deps) dependents[dep].push_back(i);
+            if (remaining_deps[i] == 0) ready.insert(i);
+        }
+
+        // List scheduling: whenever a worker is free it takes the best ready job
+        std::multiset<std::pair<double, size_t>> running; // (finish time, job)
+        double now = 0;
+        long memory_in_use_kb = 0;
+        size_t next_job;
+        while (!ready.empty() || !running.empty()) {
+            while (static_cast<int>(running.size()) < max_jobs &&
+                   pick_job(ready, jobs, memory_budget_kb, memory_in_use_kb, static_cast<int>(running.size()), next_job)) {
+                ready.erase(next_job);
+                running.insert({now + jobs[next_job].estimate_ms, next_job});
+                memory_in_use_kb += jobs[next_job].memory_kb;
+            }
+            auto first = running.begin();
+            now = first->first;
+            size_t id = first->second;
+            running.erase(first);
+            memory_in_use_kb -= jobs[id].memory_kb;
+            for (size_t next : dependents[id]) {
+                if (--remaining_deps[next] == 0) ready.insert(next);
+            }
+        }
+        return now;
+    }
+
+    bool JobScheduler::run(std::vector<Job>& jobs, int max_jobs, long memory_budget_kb) {
+        if (jobs.empty()) return true;
+        if (max_jobs <= 0) max_jobs = default_jobs();
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::vector<double> priority = critical_path_lengths(jobs);
+        ReadySet ready(ReadyOrder{&priority});
+        std::vector<size_t> remaining_deps(jobs.size(), 0);
+        std::vector<std::vector<size_t>> dependents(jobs.size());
+        size_t finished = 0;
+        int running = 0;
+        long memory_in_use_kb = 0;
+        bool implicit_slot_free = true; // Every other concurrent job needs a jobserver token
+        bool failed = false;
+
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            jobs[i].status = JobStatus::Pending;
+            remaining_deps[i] = jobs[i].deps.size();
+            for (size_t dep : jobs[i].deps) dependents[dep].push_back(i);
+            if (remaining_deps[i] == 0) ready.insert(i);
+        }
+
+        auto run_start = std::chrono::steady_clock::now();
+        auto worker = [&](int slot) {
+            std::unique_lock<std::mutex> lock(mtx);
+            while (true) {
+                size_t id = 0;
+                cv.wait(lock, [&] {
+                    return failed || finished == jobs.size() ||
+                           pick_job(ready, jobs, memory_budget_kb, memory_in_use_kb, running, id);
+                });
+                if (failed || finished == jobs.size()) break;
+
+                ready.erase(id);
+                ++running;
+                memory_in_use_kb += jobs[id].memory_kb;
+                bool uses_implicit_slot = implicit_slot_free;
+                implicit_slot_free = false;
+                if (!jobs[id].description.empty()) std::cout << jobs[id].description << std::endl;
+                lock.unlock();
+
+                if (jobs[id].prepare) jobs[id].prepare(jobs[id]);
+                char token = 0;
+                bool has_token = !uses_implicit_slot && Jobserver::acquire(token);
+                jobs[id].slot = slot;
+                jobs[id].start_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - run_start).count();
+                ProcessOptions process_options;
+                process_options.response_file = jobs[id].response_file;
+                ProcessResult result = Process::run(jobs[id].command, process_options);
+                const std::string& output = result.output;
+                int status = result.exit_code;
+                if (has_token) Jobserver::release(token);
+
+                lock.lock();
+                if (uses_implicit_slot) implicit_slot_free = true;
+                jobs[id].wall_ms = result.wall_ms;
+                jobs[id].cpu_ms = result.cpu_ms;
+                jobs[id].peak_rss_kb = result.peak_rss_kb;
+                --running;
+                memory_in_use_kb -= jobs[id].memory_kb;
+                ++finished;
+                if (!output.empty()) {
+                    std::cout << output;
+                    if (output.back() != '\n') std::cout << '\n';
+                    std::cout.flush();
+                }
+                if (status == 0) {
+                    jobs[id].status = JobStatus::Succeeded;
+                    for (size_t next : dependents[id]) {
+                        if (--remaining_deps[next] == 0) ready.insert(next);
+                    }
+                } else {
+                    jobs[id].status = JobStatus::Failed;
+                    if (!jobs[id].failure_message.empty()) std::cerr << jobs[id].failure_message << std::endl;
+                    failed = true;
+                }
+                cv.notify_all();
+            }
+            cv.notify_all();
+        };
+
+        size_t worker_count = std::min(static_cast<size_t>(max_jobs), jobs.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < worker_count; ++i) workers.emplace_back(worker, static_cast<int>(i) + 1);
+        for (auto& t : workers) t.join();
+
+        for (auto& job : jobs) {
+            if (job.status == JobStatus::Pending) job.status = JobStatus::Skipped;
+        }
+        return !failed;
+    }
+}
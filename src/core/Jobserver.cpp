@@ -0,0 +1,124 @@
+#include "../../include/core/Jobserver.h"
+#include <iostream>
+#include <cstdlib>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mule {
+
+    namespace {
+        struct State {
+            bool initialized = false;
+            bool client = false;
+            int read_fd = -1;
+            int write_fd = -1;
+        };
+
+        State& state() {
+            static State s;
+            return s;
+        }
+    }
+
+#ifndef _WIN32
+    static bool fd_is_open(int fd) {
+        return fd >= 0 && fcntl(fd, F_GETFD) != -1;
+    }
+
+    // Parses the jobserver of an outer make from MAKEFLAGS: "--jobserver-auth=R,W" (and the
+    // older "--jobserver-fds=R,W") or, since make 4.4, "--jobserver-auth=fifo:PATH".
+    static bool join_outer(const std::string& makeflags, State& s) {
+        std::string value;
+        for (const char* option : {"--jobserver-auth=", "--jobserver-fds="}) {
+            size_t pos = makeflags.rfind(option);
+            if (pos == std::string::npos) continue;
+            size_t start = pos + std::string(option).size();
+            value = makeflags.substr(start, makeflags.find(' ', start) - start);
+            break;
+        }
+        if (value.empty()) return false;
+
+        if (value.rfind("fifo:", 0) == 0) {
+            int fd = open(value.substr(5).c_str(), O_RDWR | O_CLOEXEC);
+            if (fd < 0) return false;
+            s.read_fd = s.write_fd = fd;
+            return true;
+        }
+        size_t comma = value.find(',');
+        if (comma == std::string::npos) return false;
+        int read_fd = std::atoi(value.substr(0, comma).c_str());
+        int write_fd = std::atoi(value.substr(comma + 1).c_str());
+        // make only hands the descriptors to recipes it knows to be recursive (marked '+')
+        if (!fd_is_open(read_fd) || !fd_is_open(write_fd)) return false;
+        s.read_fd = read_fd;
+        s.write_fd = write_fd;
+        return true;
+    }
+#endif
+
+    void Jobserver::init(int jobs) {
+        State& s = state();
+        if (s.initialized) return;
+        s.initialized = true;
+#ifndef _WIN32
+        const char* env = std::getenv("MAKEFLAGS");
+        std::string makeflags = env ? env : "";
+        if (join_outer(makeflags, s)) {
+            s.client = true;
+            return;
+        }
+        if (jobs <= 1) return;
+
+        // Not close-on-exec: child makes inherit the descriptors named in MAKEFLAGS
+        int fds[2];
+        if (pipe(fds) != 0) return;
+        std::string tokens(static_cast<size_t>(jobs - 1), '+');
+        if (write(fds[1], tokens.data(), tokens.size()) != static_cast<ssize_t>(tokens.size())) {
+            close(fds[0]);
+            close(fds[1]);
+            return;
+        }
+        s.read_fd = fds[0];
+        s.write_fd = fds[1];
+        std::string auth = std::to_string(fds[0]) + "," + std::to_string(fds[1]);
+        makeflags = " -j" + std::to_string(jobs) + " --jobserver-auth=" + auth + (makeflags.empty() ? "" : " " + makeflags);
+        setenv("MAKEFLAGS", makeflags.c_str(), 1);
+#else
+        (void)jobs;
+#endif
+    }
+
+    bool Jobserver::is_client() {
+        return state().client;
+    }
+
+    bool Jobserver::acquire(char& token) {
+#ifndef _WIN32
+        const State& s = state();
+        if (s.read_fd < 0) return false;
+        while (true) {
+            ssize_t n = read(s.read_fd, &token, 1);
+            if (n == 1) return true;
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+#else
+        (void)token;
+        return false;
+#endif
+    }
+
+    void Jobserver::release(char token) {
+#ifndef _WIN32
+        const State& s = state();
+        if (s.write_fd < 0) return;
+        while (write(s.write_fd, &token, 1) < 0 && errno == EINTR) {}
+#else
+        (void)token;
+#endif
+    }
+}
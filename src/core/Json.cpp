@@ -0,0 +1,172 @@
+#include "../../include/core/Json.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+
+namespace mule {
+
+    namespace {
+        struct Parser {
+            const std::string& text;
+            size_t pos = 0;
+
+            void skip_ws() {
+                while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+            }
+
+            bool literal(const char* word) {
+                size_t len = std::char_traits<char>::length(word);
+                if (text.compare(pos, len, word) != 0) return false;
+                pos += len;
+                return true;
+            }
+
+            static void append_utf8(std::string& out, unsigned long cp) {
+                if (cp < 0x80) {
+                    out += static_cast<char>(cp);
+                } else if (cp < 0x800) {
+                    out += static_cast<char>(0xC0 | (cp >> 6));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000) {
+                    out += static_cast<char>(0xE0 | (cp >> 12));
+                    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                } else {
+                    out += static_cast<char>(0xF0 | (cp >> 18));
+                    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+            }
+
+            bool parse_string(std::string& out) {
+                if (pos >= text.size() || text[pos] != '"') return false;
+                ++pos;
+                while (pos < text.size() && text[pos] != '"') {
+                    char c = text[pos++];
+                    if (c != '\\') {
+                        out += c;
+                        continue;
+                    }
+                    if (pos >= text.size()) return false;
+                    char esc = text[pos++];
+                    switch (esc) {
+                        case 'n': out += '\n'; break;
+                        case 't': out += '\t'; break;
+                        case 'r': out += '\r'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'u': {
+                            if (pos + 4 > text.size()) return false;
+                            unsigned long cp = std::strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                            pos += 4;
+                            // Surrogate pair
+                            if (cp >= 0xD800 && cp <= 0xDBFF && pos + 6 <= text.size() && text[pos] == '\\' && text[pos + 1] == 'u') {
+                                unsigned long low = std::strtoul(text.substr(pos + 2, 4).c_str(), nullptr, 16);
+                                pos += 6;
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            }
+                            append_utf8(out, cp);
+                            break;
+                        }
+                        default: out += esc; break;
+                    }
+                }
+                if (pos >= text.size()) return false;
+                ++pos;
+                return true;
+            }
+
+            bool parse_value(JsonValue& out) {
+                skip_ws();
+                if (pos >= text.size()) return false;
+                char c = text[pos];
+                if (c == '{') {
+                    out.type = JsonValue::Type::Object;
+                    ++pos;
+                    skip_ws();
+                    if (pos < text.size() && text[pos] == '}') { ++pos; return true; }
+                    while (true) {
+                        skip_ws();
+                        std::string key;
+                        if (!parse_string(key)) return false;
+                        skip_ws();
+                        if (pos >= text.size() || text[pos] != ':') return false;
+                        ++pos;
+                        if (!parse_value(out.object[key])) return false;
+                        skip_ws();
+                        if (pos < text.size() && text[pos] == ',') { ++pos; continue; }
+                        if (pos < text.size() && text[pos] == '}') { ++pos; return true; }
+                        return false;
+                    }
+                }
+                if (c == '[') {
+                    out.type = JsonValue::Type::Array;
+                    ++pos;
+                    skip_ws();
+                    if (pos < text.size() && text[pos] == ']') { ++pos; return true; }
+                    while (true) {
+                        out.array.emplace_back();
+                        if (!parse_value(out.array.back())) return false;
+                        skip_ws();
+                        if (pos < text.size() && text[pos] == ',') { ++pos; continue; }
+                        if (pos < text.size() && text[pos] == ']') { ++pos; return true; }
+                        return false;
+                    }
+                }
+                if (c == '"') {
+                    out.type = JsonValue::Type::String;
+                    return parse_string(out.string);
+                }
+                if (literal("true")) { out.type = JsonValue::Type::Bool; out.boolean = true; return true; }
+                if (literal("false")) { out.type = JsonValue::Type::Bool; out.boolean = false; return true; }
+                if (literal("null")) { out.type = JsonValue::Type::Null; return true; }
+
+                const char* start = text.c_str() + pos;
+                char* end = nullptr;
+                out.number = std::strtod(start, &end);
+                if (end == start) return false;
+                out.type = JsonValue::Type::Number;
+                pos += static_cast<size_t>(end - start);
+                return true;
+            }
+        };
+    }
+
+    const JsonValue& JsonValue::operator[](const std::string& key) const {
+        static const JsonValue null_value;
+        if (type != Type::Object) return null_value;
+        auto it = object.find(key);
+        return it == object.end() ? null_value : it->second;
+    }
+
+    bool JsonValue::parse(const std::string& text, JsonValue& out) {
+        Parser parser{text};
+        out = JsonValue{};
+        if (!parser.parse_value(out)) return false;
+        parser.skip_ws();
+        return parser.pos == text.size();
+    }
+
+    std::string JsonValue::quote(const std::string& text) {
+        std::string out = "\"";
+        for (unsigned char c : text) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        char buffer[8];
+                        std::snprintf(buffer, sizeof buffer, "\\u%04x", c);
+                        out += buffer;
+                    } else {
+                        out += static_cast<char>(c);
+                    }
+            }
+        }
+        return out + "\"";
+    }
+}
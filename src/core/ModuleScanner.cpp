@@ -0,0 +1,232 @@
+#include "../../include/core/ModuleScanner.h"
+#include "../../include/core/Json.h"
+#include "../../include/core/Utils.h"
+#include "../../include/core/Process.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cctype>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    static std::string read_file(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }
+
+    // Removes comments and the contents of string/char literals, keeping newlines.
+    static std::string strip_comments(const std::string& src) {
+        std::string out;
+        out.reserve(src.size());
+        for (size_t i = 0; i < src.size(); ++i) {
+            char c = src[i];
+            if (c == '/' && i + 1 < src.size() && src[i + 1] == '/') {
+                while (i < src.size() && src[i] != '\n') ++i;
+                if (i < src.size()) out += '\n';
+            } else if (c == '/' && i + 1 < src.size() && src[i + 1] == '*') {
+                i += 2;
+                while (i + 1 < src.size() && !(src[i] == '*' && src[i + 1] == '/')) {
+                    if (src[i] == '\n') out += '\n';
+                    ++i;
+                }
+                ++i;
+                out += ' ';
+            } else if (c == '"' || c == '\'') {
+                out += c;
+                for (++i; i < src.size() && src[i] != c && src[i] != '\n'; ++i) {
+                    if (src[i] == '\\') ++i;
+                }
+                out += c;
+            } else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    static std::string trim(const std::string& str) {
+        size_t start = str.find_first_not_of(" \t\r");
+        if (start == std::string::npos) return "";
+        size_t end = str.find_last_not_of(" \t\r");
+        return str.substr(start, end - start + 1);
+    }
+
+    static bool starts_with_word(const std::string& line, const std::string& word) {
+        return line.compare(0, word.size(), word) == 0 &&
+               (line.size() == word.size() || !(isalnum(static_cast<unsigned char>(line[word.size()])) || line[word.size()] == '_'));
+    }
+
+    static std::string remove_spaces(std::string str) {
+        std::string out;
+        for (char c : str) if (!isspace(static_cast<unsigned char>(c))) out += c;
+        return out;
+    }
+
+    bool ModuleScanner::is_interface_extension(const std::string& path) {
+        std::string ext = fs::path(path).extension().string();
+        return ext == ".cppm" || ext == ".ixx" || ext == ".mpp";
+    }
+
+    bool ModuleScanner::standard_has_modules(const std::string& standard) {
+        if (standard == "2a" || standard == "2b" || standard == "2c") return true;
+        try {
+            int year = std::stoi(standard);
+            return year >= 20 && year < 98;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    ModuleInfo ModuleScanner::scan_declarations(const std::string& content) {
+        ModuleInfo info;
+        std::string module_name;
+        std::istringstream lines(strip_comments(content));
+        std::string line;
+
+        // Module and import declarations must start a logical line ([cpp.pre]/P1857)
+        while (std::getline(lines, line)) {
+            line = trim(line);
+            bool exported = false;
+            if (starts_with_word(line, "export")) {
+                exported = true;
+                line = trim(line.substr(6));
+            }
+
+            if (starts_with_word(line, "module")) {
+                std::string decl = remove_spaces(line.substr(6));
+                size_t semi = decl.find(';');
+                if (semi == std::string::npos) continue;
+                decl = decl.substr(0, semi);
+                if (decl.empty() || decl.rfind(":private", 0) == 0) continue; // Global/private module fragment
+
+                size_t colon = decl.find(':');
+                module_name = decl.substr(0, colon);
+                if (exported || colon != std::string::npos) {
+                    // Interface unit or (internal) partition
+                    info.provides = decl;
+                } else {
+                    // Implementation unit implicitly imports its interface
+                    info.imports.push_back(decl);
+                }
+            } else if (starts_with_word(line, "import")) {
+                std::string decl = trim(line.substr(6));
+                if (decl.empty() || decl[0] == '<' || decl[0] == '"') continue; // Header units
+                decl = remove_spaces(decl);
+                size_t semi = decl.find(';');
+                if (semi == std::string::npos) continue;
+                decl = decl.substr(0, semi);
+                if (decl.empty()) continue;
+                if (decl[0] == ':') decl = module_name + decl; // Partition of the current module
+                info.imports.push_back(decl);
+            }
+        }
+        return info;
+    }
+
+    bool ModuleScanner::parse_p1689(const std::string& json, ModuleInfo& out) {
+        JsonValue root;
+        if (!JsonValue::parse(json, root)) return false;
+        const JsonValue& rules = root["rules"];
+        if (rules.type != JsonValue::Type::Array) return false;
+
+        out = ModuleInfo{};
+        for (const auto& rule : rules.array) {
+            for (const auto& provided : rule["provides"].array) {
+                out.provides = provided["logical-name"].string;
+            }
+            for (const auto& required : rule["requires"].array) {
+                // Header units carry a source path and are not part of the named module graph
+                if (!required["source-path"].is_null() && required["lookup-method"].string != "by-name") continue;
+                out.imports.push_back(required["logical-name"].string);
+            }
+        }
+        return true;
+    }
+
+    ModuleScanner::ModuleScanner(CompilerType type) {
+        scanner_ = "declarations";
+        if (type == CompilerType::Clang && command_exists("clang-scan-deps")) {
+            scanner_ = "clang-scan-deps";
+        }
+    }
+
+    // Text format, one TU per line: path \t hash \t provides \t imports (space separated)
+    void ModuleScanner::load() {
+        cache_.clear();
+        std::ifstream in(CACHE_PATH);
+        std::string line;
+        std::getline(in, line);
+        if (line != scanner_) return; // Different scanner, results may differ
+
+        while (std::getline(in, line)) {
+            std::vector<std::string> fields;
+            std::stringstream ss(line);
+            std::string field;
+            while (std::getline(ss, field, '\t')) fields.push_back(field);
+            // A line cut off by an interrupted save is a miss; the TU is scanned again
+            if (fields.size() < 3 || in.eof()) continue;
+
+            CacheEntry entry;
+            try {
+                size_t end = 0;
+                entry.hash = std::stoull(fields[1], &end, 16);
+                if (end != fields[1].size()) continue;
+            } catch (...) {
+                continue;
+            }
+            entry.info.provides = fields[2];
+            if (fields.size() > 3) {
+                std::stringstream reqs(fields[3]);
+                std::string req;
+                while (reqs >> req) entry.info.imports.push_back(req);
+            }
+            cache_[fields[0]] = entry;
+        }
+    }
+
+    void ModuleScanner::save() {
+        if (!dirty_) return;
+        fs::create_directories(fs::path(CACHE_PATH).parent_path());
+        std::ofstream out(CACHE_PATH, std::ios::trunc);
+        out << scanner_ << "\n";
+        for (const auto& [path, entry] : cache_) {
+            out << path << "\t" << to_hex(entry.hash) << "\t" << entry.info.provides << "\t";
+            for (size_t i = 0; i < entry.info.imports.size(); ++i) {
+                out << (i ? " " : "") << entry.info.imports[i];
+            }
+            out << "\n";
+        }
+        dirty_ = false;
+    }
+
+    bool ModuleScanner::scan(BuildDb& db, const std::string& src, const std::string& compile_cmd, ModuleInfo& out) {
+        uint64_t hash;
+        if (!db.file_hash(src, hash)) return false;
+        if (scanner_ == "clang-scan-deps") hash = hash_string(compile_cmd, hash);
+
+        auto it = cache_.find(src);
+        if (it != cache_.end() && it->second.hash == hash) {
+            out = it->second.info;
+            return true;
+        }
+
+        if (scanner_ == "clang-scan-deps") {
+            ProcessOptions options;
+            options.merge_stderr = false; // Keep warnings out of the JSON
+            ProcessResult result = Process::run("clang-scan-deps -format=p1689 -- " + compile_cmd, options);
+            if (result.exit_code != 0 || !parse_p1689(result.output, out)) {
+                return false;
+            }
+        } else {
+            out = scan_declarations(read_file(src));
+        }
+
+        cache_[src] = CacheEntry{hash, out};
+        dirty_ = true;
+        return true;
+    }
+}
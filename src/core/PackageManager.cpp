@@ -1,127 +1,881 @@
 #include "../../include/core/PackageManager.h"
+#include "../../include/core/ArtifactCache.h"
+#include "../../include/core/Process.h"
+#include "../../include/core/Store.h"
+#include "../../include/core/Utils.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
-#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <thread>
+#include <mutex>
 
 namespace fs = std::filesystem;
 
 namespace mule {
 
-    std::string get_git_head(const fs::path& repo_path) {
-        std::string cwd = fs::current_path().string();
-        fs::current_path(repo_path);
-        std::system("git rev-parse HEAD > .git_head_tmp");
-        std::ifstream f(".git_head_tmp");
-        std::string hash;
-        f >> hash;
-        fs::remove(".git_head_tmp");
-        fs::current_path(cwd);
-        return hash;
+    // First line of a small git metadata file, without trailing whitespace.
+    static std::string read_git_file(const fs::path& path) {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        while (!line.empty() && isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+        return line;
     }
 
-    void PackageManager::build_dependencies(const std::vector<Dependency>& deps, CompilerType compiler_type) {
-        if (deps.empty()) return;
+    // Value of ref (e.g. refs/heads/main) in a packed-refs file, empty if it is not there.
+    static std::string packed_ref(const fs::path& path, const std::string& ref) {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t space = line.find(' ');
+            if (space == std::string::npos || line[0] == '#' || line[0] == '^') continue;
+            std::string name = line.substr(space + 1);
+            while (!name.empty() && isspace(static_cast<unsigned char>(name.back()))) name.pop_back();
+            if (name == ref) return line.substr(0, space);
+        }
+        return "";
+    }
+
+    // The commit checked out in the work tree that contains dir, read from .git/HEAD and the
+    // refs it names without running git. Empty if it cannot be determined.
+    static std::string read_git_head(const fs::path& dir) {
+        std::error_code ec;
+        fs::path root = fs::canonical(dir, ec);
+        if (ec) return "";
+
+        // Store worktrees (and submodules) have a .git file: "gitdir: <path>"
+        fs::path git_dir;
+        for (fs::path p = root;; p = p.parent_path()) {
+            fs::path dot_git = p / ".git";
+            if (fs::is_directory(dot_git, ec)) {
+                git_dir = dot_git;
+                break;
+            }
+            if (fs::is_regular_file(dot_git, ec)) {
+                std::string line = read_git_file(dot_git);
+                if (line.rfind("gitdir: ", 0) != 0) return "";
+                git_dir = fs::path(line.substr(8));
+                if (git_dir.is_relative()) git_dir = p / git_dir;
+                break;
+            }
+            if (p == p.parent_path()) return "";
+        }
+
+        // A linked worktree keeps its own HEAD; branches live in the repository's commondir
+        fs::path common_dir = git_dir;
+        std::string common = read_git_file(git_dir / "commondir");
+        if (!common.empty()) common_dir = fs::path(common).is_relative() ? git_dir / common : fs::path(common);
+
+        std::string head = read_git_file(git_dir / "HEAD");
+        for (int depth = 0; depth < 8 && head.rfind("ref: ", 0) == 0; ++depth) {
+            std::string ref = head.substr(5);
+            head = read_git_file(git_dir / ref);
+            if (head.empty()) head = read_git_file(common_dir / ref);
+            if (head.empty()) head = packed_ref(common_dir / "packed-refs", ref);
+        }
+        if (head.size() != 40 && head.size() != 64) return "";
+        for (char c : head) {
+            if (!isxdigit(static_cast<unsigned char>(c))) return "";
+        }
+        return head;
+    }
+
+    static fs::path dependency_build_dir(const std::string& name) {
+        return fs::path(".mule/build") / name;
+    }
+
+    // Replaces dest with a copy of the tree at src, minus .git. Git Make dependencies build in
+    // such a copy: make writes into its source tree, and the store worktree is shared by every
+    // project on the machine that pins the same commit.
+    static bool copy_source_tree(const fs::path& src, const fs::path& dest) {
+        std::error_code ec;
+        fs::remove_all(dest, ec);
+        fs::path root = fs::canonical(src, ec);
+        if (!ec) fs::create_directories(dest, ec);
+        for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->path().filename() == ".git") {
+                it.disable_recursion_pending();
+                continue;
+            }
+            fs::path target = dest / fs::relative(it->path(), root);
+            if (it->is_symlink(ec)) {
+                fs::copy_symlink(it->path(), target, ec);
+            } else if (it->is_directory(ec)) {
+                fs::create_directories(target, ec);
+            } else {
+                fs::copy_file(it->path(), target, fs::copy_options::overwrite_existing, ec);
+            }
+        }
+        return !ec;
+    }
+
+    std::string PackageManager::install_dir(const std::string& name) {
+        return (fs::path(".mule/install") / name).string();
+    }
+
+    static fs::path install_prefix(const std::string& name) {
+        return fs::absolute(PackageManager::install_dir(name));
+    }
+
+    // Generator a CMake build directory was configured with, empty if it was not.
+    static std::string configured_generator(const fs::path& build_dir) {
+        std::ifstream cache(build_dir / "CMakeCache.txt");
+        std::string line;
+        while (std::getline(cache, line)) {
+            if (line.rfind("CMAKE_GENERATOR:INTERNAL=", 0) == 0) return line.substr(25);
+        }
+        return "";
+    }
+
+    static fs::path stamp_path(const std::string& name) {
+        return fs::path(".mule/stamps/deps") / name;
+    }
+
+    namespace {
+        struct TreeEntry {
+            std::string path; // Relative to the dependency root
+            int64_t mtime = 0;
+            uint64_t size = 0;
+            bool operator==(const TreeEntry& other) const {
+                return path == other.path && mtime == other.mtime && size == other.size;
+            }
+        };
+    }
 
+    // Every file of a path dependency except its build directory and VCS metadata, sorted.
+    static std::vector<TreeEntry> scan_tree(const fs::path& root) {
+        std::vector<TreeEntry> entries;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (it->is_directory() && (name == ".git" || (it.depth() == 0 && name == "build"))) {
+                it.disable_recursion_pending();
+                continue;
+            }
+            if (!it->is_regular_file()) continue;
+            TreeEntry entry;
+            entry.path = fs::relative(it->path(), root).generic_string();
+            entry.mtime = static_cast<int64_t>(it->last_write_time().time_since_epoch().count());
+            entry.size = it->file_size();
+            entries.push_back(entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](const TreeEntry& a, const TreeEntry& b) { return a.path < b.path; });
+        return entries;
+    }
+
+    static std::string tree_content_hash(const fs::path& root, const std::vector<TreeEntry>& entries) {
+        uint64_t combined = hash_string("");
+        for (const auto& entry : entries) {
+            uint64_t h = 0;
+            hash_file((root / entry.path).string(), h);
+            combined = hash_string(entry.path, combined);
+            combined = hash_string(std::string(reinterpret_cast<const char*>(&h), sizeof h), combined);
+        }
+        return to_hex(combined);
+    }
+
+    // Stamp format:
+    //   key <hex>
+    //   content <hex>             (path dependencies only, followed by the file list
+    //   <mtime> <size> <path>      the hash was taken from, to skip rehashing unchanged trees)
+    static void write_stamp(const DependencyBuild& build, const std::string& content, const std::vector<TreeEntry>& entries) {
+        fs::path path = stamp_path(build.name);
+        fs::create_directories(path.parent_path());
+        fs::path tmp_path = path.string() + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::trunc);
+            out << "key " << build.key << "\n";
+            if (build.is_path) {
+                out << "content " << content << "\n";
+                for (const auto& entry : entries) out << entry.mtime << " " << entry.size << " " << entry.path << "\n";
+            }
+            if (!out) return;
+        }
+        std::error_code ec;
+        fs::rename(tmp_path, path, ec);
+    }
+
+    static bool stamp_is_current(const DependencyBuild& build) {
+        // The previous outputs must still be there to be reused. An install restored from the
+        // artifact cache has no build directory, and needs none while the prefix is filled.
+        if (!build.build_dir.empty()) {
+            fs::path prefix = install_prefix(build.name);
+            std::error_code ec;
+            if (!fs::exists(prefix)) return false;
+            if (fs::is_empty(prefix, ec) && !fs::exists(fs::path(build.build_dir) / "CMakeCache.txt")) return false;
+        }
+
+        std::ifstream in(stamp_path(build.name));
+        std::string line;
+        if (!std::getline(in, line) || line != "key " + build.key) return false;
+        if (!build.is_path) return true;
+
+        if (!std::getline(in, line) || line.rfind("content ", 0) != 0) return false;
+        std::string content = line.substr(8);
+        std::vector<TreeEntry> recorded;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            TreeEntry entry;
+            if (!(fields >> entry.mtime >> entry.size)) return false;
+            fields.get();
+            std::getline(fields, entry.path);
+            recorded.push_back(entry);
+        }
+
+        std::vector<TreeEntry> current = scan_tree(build.path);
+        if (current == recorded) return true;
+        // Touched but not necessarily changed: compare contents, and remember the new stats
+        if (tree_content_hash(build.path, current) != content) return false;
+        write_stamp(build, content, current);
+        return true;
+    }
+
+    std::vector<DependencyBuild> PackageManager::dependency_builds(const std::vector<Dependency>& deps, const std::string& toolchain_identity,
+                                                                   const std::string& standard, const std::string& build_type,
+                                                                   int parallel_jobs, bool use_artifacts) {
+        std::vector<DependencyBuild> builds;
         fs::path deps_root = ".mule/deps";
-        if (!fs::exists(deps_root)) return;
+        if (deps.empty() || !fs::exists(deps_root)) return builds;
 
+        bool has_ninja = !find_executable("ninja").empty();
         for (const auto& dep : deps) {
             fs::path lib_path = deps_root / dep.name;
-            if (!fs::exists(lib_path)) continue;
-
-            std::string cwd = fs::current_path().string();
-            fs::current_path(lib_path);
-
-            // 1. Check for CMakeLists.txt
-            if (fs::exists("CMakeLists.txt")) {
-                std::cout << "Building dependency with CMake: " << dep.name << std::endl;
-                if (!fs::exists("build")) fs::create_directory("build");
-                
-                std::string cmake_cmd = "cmake -B build -S .";
-                // Optionally pass compiler info to cmake if needed
-                // if (compiler_type == CompilerType::MSVC) cmake_cmd += " -G \"Visual Studio 17 2022\"";
-                
-                if (std::system(cmake_cmd.c_str()) == 0) {
-                    std::system("cmake --build build --config Release");
+            if (!fs::exists(lib_path) || fs::exists(lib_path / "mule.toml")) continue;
+
+            DependencyBuild build;
+            build.name = dep.name;
+            build.path = lib_path.string();
+            build.is_path = !dep.path.empty();
+            std::vector<std::string> key_parts; // Build commands, minus the parallelism
+            bool is_cmake = false;
+
+            // 1. Check for CMakeLists.txt: out of source build in .mule/build/<name>, installed
+            // into .mule/install/<name>
+            if (fs::exists(lib_path / "CMakeLists.txt")) {
+                fs::path build_dir = dependency_build_dir(dep.name);
+                std::string generator = has_ninja ? "Ninja" : "";
+                build.build_dir = build_dir.string();
+                build.install_dir = install_dir(dep.name);
+                is_cmake = true;
+
+                Job configure;
+                configure.description = "Configuring dependency with CMake: " + dep.name;
+                configure.command = "cmake -S " + Process::quote(lib_path.string()) + " -B " + Process::quote(build_dir.string()) +
+                                    (generator.empty() ? "" : " -G " + generator) + " -DCMAKE_BUILD_TYPE=" + build_type +
+                                    (standard.empty() ? "" : " -DCMAKE_CXX_STANDARD=" + standard) +
+                                    " -DCMAKE_INSTALL_PREFIX=" + Process::quote(install_prefix(dep.name).string());
+                configure.failure_message = "CMake configuration failed for " + dep.name;
+                key_parts.push_back(configure.command);
+
+                Job compile;
+                compile.description = "Building dependency with CMake: " + dep.name;
+                compile.command = "cmake --build " + Process::quote(build_dir.string()) + " --config " + build_type;
+                key_parts.push_back(compile.command);
+                // Make takes its parallelism from the jobserver in MAKEFLAGS; an explicit -j
+                // would make it leave the jobserver. Ninja needs to be told.
+                if (!generator.empty() && parallel_jobs > 0) compile.command += " --parallel " + std::to_string(parallel_jobs);
+                compile.failure_message = "CMake build failed for " + dep.name;
+                compile.deps.push_back(0);
+
+                Job install;
+                install.description = "Installing dependency: " + dep.name;
+                install.command = "cmake --install " + Process::quote(build_dir.string()) + " --config " + build_type;
+                install.failure_message = "CMake install failed for " + dep.name;
+                install.deps.push_back(1);
+                key_parts.push_back(install.command);
+
+                build.jobs = {configure, compile, install};
+                if (use_artifacts && !build.is_path) build.artifact_key = ArtifactCache::key(dep, toolchain_identity, standard, build_type);
+            }
+            // 2. Check for Makefile if no CMake: path dependencies build in place, git ones in a
+            // private copy in .mule/build/<name>
+            else if (fs::exists(lib_path / "Makefile") || fs::exists(lib_path / "makefile")) {
+                if (!build.is_path) build.build_dir = dependency_build_dir(dep.name).string();
+                Job compile;
+                compile.description = "Building dependency with Make: " + dep.name;
+                compile.command = "make -C " + Process::quote(build.is_path ? lib_path.string() : build.build_dir);
+                compile.failure_message = "Make failed for " + dep.name;
+                build.jobs.push_back(compile);
+                key_parts.push_back(compile.command);
+            }
+            // 3. Fallback: maybe it's just a header-only or simple source project,
+            // Mule already handles include discovery in Builder.cpp
+            if (build.jobs.empty()) continue;
+
+            uint64_t key = hash_string(VERSION);
+            key = hash_string(toolchain_identity, key);
+            key = hash_string(build.is_path ? "path" : dep.commit, key);
+            for (const auto& part : key_parts) key = hash_string(part, key);
+            build.key = to_hex(key);
+
+            if (stamp_is_current(build)) {
+                std::cout << "Dependency up to date: " << dep.name << std::endl;
+                continue;
+            }
+            if (!is_cmake && !build.build_dir.empty()) {
+                // A new commit or toolchain: start over from a fresh copy of the worktree
+                if (!copy_source_tree(lib_path, build.build_dir)) {
+                    std::cerr << "Warning: could not copy " << dep.name << " into " << build.build_dir << "; skipping its build." << std::endl;
+                    continue;
+                }
+            }
+            if (is_cmake) {
+                // CMake refuses to switch generators in an existing build directory
+                std::string configured = configured_generator(build.build_dir);
+                if (!configured.empty() && (configured == "Ninja") != has_ninja) fs::remove_all(build.build_dir);
+                // Start from an empty prefix so libraries the dependency dropped are not linked
+                std::error_code ec;
+                fs::remove_all(install_prefix(dep.name), ec);
+                fs::create_directories(install_prefix(dep.name), ec);
+                if (!build.artifact_key.empty() && ArtifactCache::restore(build.artifact_key, install_prefix(dep.name).string())) {
+                    std::cout << "Restored dependency from artifact cache: " << dep.name << std::endl;
+                    build.jobs.clear();
+                    build.restored = true;
+                }
+            }
+            builds.push_back(build);
+        }
+        return builds;
+    }
+
+    void PackageManager::write_dependency_stamp(const DependencyBuild& build) {
+        std::vector<TreeEntry> entries;
+        std::string content;
+        if (build.is_path) {
+            entries = scan_tree(build.path);
+            content = tree_content_hash(build.path, entries);
+        }
+        write_stamp(build, content, entries);
+        if (!build.artifact_key.empty() && !build.restored) ArtifactCache::store(build.artifact_key, install_prefix(build.name).string());
+    }
+
+    static bool is_library_file(const fs::path& path) {
+        std::string ext = path.extension().string();
+        return ext == ".a" || ext == ".lib" || ext == ".so" || ext == ".dylib" ||
+               path.filename().string().find(".so.") != std::string::npos;
+    }
+
+    // A system library or flag named in INTERFACE_LINK_LIBRARIES, as a linker flag: "m" ->
+    // -lm, Threads::Threads -> -pthread. Empty for what cannot be linked from here, e.g.
+    // targets of other packages.
+    static std::string system_link_flag(const std::string& item) {
+        if (item == "Threads::Threads") {
+#ifdef _WIN32
+            return "";
+#else
+            return "-pthread";
+#endif
+        }
+        if (item.find("::") != std::string::npos) return "";
+        if (item[0] == '-' || item.find('/') != std::string::npos || is_library_file(item)) return item;
+#ifdef _WIN32
+        return item + ".lib";
+#else
+        return "-l" + item;
+#endif
+    }
+
+    // Link line of the CMake package an install wrote, from its targets files, e.g.
+    // lib/cmake/fmt/fmt-targets.cmake and fmt-targets-release.cmake:
+    //   set_target_properties(fmt::fmt PROPERTIES
+    //     INTERFACE_LINK_LIBRARIES "fmt::base;Threads::Threads;\$<LINK_ONLY:m>"
+    //     IMPORTED_LOCATION_RELEASE "${_IMPORT_PREFIX}/lib/libfmt.a"
+    //     )
+    // libraries gets the library files, each before the ones it links against, so static
+    // libraries that depend on each other resolve in one pass; system_flags gets the system
+    // libraries they need, to go after all of them.
+    static void cmake_package_libraries(const fs::path& prefix, const std::string& build_type,
+                                        std::vector<std::string>& libraries, std::vector<std::string>& system_flags) {
+        std::string config_upper = build_type;
+        std::transform(config_upper.begin(), config_upper.end(), config_upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+        std::vector<fs::path> files;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(prefix, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->path().extension() == ".cmake") files.push_back(it->path());
+        }
+        std::sort(files.begin(), files.end());
+
+        struct Target {
+            std::string location, implib;
+            std::vector<std::string> links; // INTERFACE_LINK_LIBRARIES, generator expressions resolved
+        };
+        std::map<std::string, Target> targets;
+        std::vector<std::string> order; // Targets as their files declare them
+        for (const auto& file : files) {
+            std::ifstream in(file);
+            std::string line, current;
+            auto value_of = [&](const std::string& property) -> std::optional<std::string> {
+                size_t pos = line.find(property + " \"");
+                if (pos == std::string::npos) return std::nullopt;
+                size_t start = pos + property.size() + 2;
+                std::string value = line.substr(start, line.find('"', start) - start);
+                for (size_t var; (var = value.find("${_IMPORT_PREFIX}")) != std::string::npos;) value.replace(var, 17, prefix.generic_string());
+                return value;
+            };
+            while (std::getline(in, line)) {
+                size_t open = line.find("set_target_properties(");
+                if (open != std::string::npos) {
+                    std::istringstream fields(line.substr(open + 22));
+                    fields >> current;
+                    if (!targets.count(current)) order.push_back(current);
+                    targets[current];
+                    continue;
+                }
+                if (current.empty()) continue;
+                Target& target = targets[current];
+                if (auto value = value_of("IMPORTED_IMPLIB_" + config_upper)) {
+                    target.implib = *value;
+                } else if (auto value = value_of("IMPORTED_LOCATION_" + config_upper)) {
+                    target.location = *value;
+                } else if (auto value = value_of("INTERFACE_LINK_LIBRARIES")) {
+                    std::stringstream items(*value);
+                    std::string item;
+                    while (std::getline(items, item, ';')) {
+                        if (!item.empty() && item[0] == '\\') item.erase(0, 1);
+                        // $<LINK_ONLY:x> only keeps x out of usage requirements; other generator
+                        // expressions depend on the consumer and are skipped
+                        if (item.rfind("$<LINK_ONLY:", 0) == 0 && item.back() == '>') item = item.substr(12, item.size() - 13);
+                        if (!item.empty() && item.find("$<") == std::string::npos) target.links.push_back(item);
+                    }
+                } else if (line.find(')') != std::string::npos && line.find('(') == std::string::npos) {
+                    current.clear();
+                }
+            }
+        }
+
+        // Depth-first over the link interface; reversing the post-order puts every library
+        // before what it depends on
+        std::vector<std::string> post_order;
+        std::map<std::string, bool> visited;
+        std::function<void(const std::string&)> visit = [&](const std::string& name) {
+            if (visited[name]) return;
+            visited[name] = true;
+            for (const auto& link : targets[name].links) {
+                if (targets.count(link)) {
+                    visit(link);
                 } else {
-                    std::cerr << "CMake configuration failed for " << dep.name << std::endl;
+                    std::string flag = system_link_flag(link);
+                    if (!flag.empty() && std::find(system_flags.begin(), system_flags.end(), flag) == system_flags.end()) system_flags.push_back(flag);
+                }
+            }
+            post_order.push_back(name);
+        };
+        for (auto it = order.rbegin(); it != order.rend(); ++it) visit(*it);
+        for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+            // DLLs are linked through their import library
+            const Target& target = targets[*it];
+            std::string library = target.implib.empty() ? target.location : target.implib;
+            if (!library.empty() && is_library_file(library) &&
+                std::find(libraries.begin(), libraries.end(), library) == libraries.end()) libraries.push_back(library);
+        }
+    }
+
+    // Libs of the pkg-config files an install wrote, with their variables expanded.
+    static std::vector<std::string> pkg_config_libraries(const fs::path& prefix) {
+        std::vector<fs::path> files;
+        for (const char* dir : {"lib/pkgconfig", "lib64/pkgconfig", "share/pkgconfig"}) {
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(prefix / dir, ec)) {
+                if (entry.path().extension() == ".pc") files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        std::vector<std::string> flags;
+        for (const auto& file : files) {
+            std::ifstream in(file);
+            std::map<std::string, std::string> variables;
+            auto expand = [&](std::string text) {
+                size_t pos;
+                for (int depth = 0; depth < 16 && (pos = text.find("${")) != std::string::npos; ++depth) {
+                    size_t end = text.find('}', pos);
+                    if (end == std::string::npos) break;
+                    text.replace(pos, end - pos + 1, variables[text.substr(pos + 2, end - pos - 2)]);
+                }
+                return text;
+            };
+            std::string line;
+            while (std::getline(in, line)) {
+                size_t colon = line.find(':'), equals = line.find('=');
+                if (equals != std::string::npos && (colon == std::string::npos || equals < colon)) {
+                    variables[line.substr(0, equals)] = expand(line.substr(equals + 1));
+                } else if (line.rfind("Libs:", 0) == 0) {
+                    std::istringstream fields(expand(line.substr(5)));
+                    std::string flag;
+                    while (fields >> flag) {
+                        if (std::find(flags.begin(), flags.end(), flag) == flags.end()) flags.push_back(flag);
+                    }
                 }
-            } 
-            // 2. Check for Makefile if no CMake
-            else if (fs::exists("Makefile") || fs::exists("makefile")) {
-                std::cout << "Building dependency with Make: " << dep.name << std::endl;
-                if (std::system("make") != 0) {
-                    std::cerr << "Make failed for " << dep.name << std::endl;
+            }
+        }
+        return flags;
+    }
+
+    void PackageManager::link_dependencies(const std::vector<Dependency>& deps, const std::string& build_type, Config& config) {
+        for (const auto& dep : deps) {
+            fs::path lib_path = fs::path(".mule/deps") / dep.name;
+            if (!fs::exists(lib_path) || fs::exists(lib_path / "mule.toml")) continue;
+
+            if (fs::exists(lib_path / "CMakeLists.txt")) {
+                fs::path prefix = install_prefix(dep.name);
+                std::vector<std::string> libraries, system_flags;
+                cmake_package_libraries(prefix, build_type, libraries, system_flags);
+                if (!libraries.empty()) {
+                    for (const auto& library : libraries) config.build.linker_flags.push_back(Process::quote(library));
+                    config.build.linker_flags.insert(config.build.linker_flags.end(), system_flags.begin(), system_flags.end());
+                    continue;
+                }
+                std::vector<std::string> flags = pkg_config_libraries(prefix);
+                if (!flags.empty()) {
+                    config.build.linker_flags.insert(config.build.linker_flags.end(), flags.begin(), flags.end());
+                    continue;
                 }
+                // No package metadata installed (e.g. no install rules): [build] libs are
+                // looked up where the build left them
+                config.build.lib_dirs.push_back(dependency_build_dir(dep.name).string());
+                continue;
             }
-            // 3. Fallback: maybe it's just a header-only or simple source project, 
-            // Mule already handles include discovery in Builder.cpp
 
-            fs::current_path(cwd);
+            // Make and prebuilt dependencies: search for libraries in their 'build' or 'lib'
+            // directories, for git Make dependencies in the copy they were built in
+            if (dep.path.empty() && (fs::exists(lib_path / "Makefile") || fs::exists(lib_path / "makefile"))) {
+                lib_path = dependency_build_dir(dep.name);
+            }
+            for (const char* dir : {"build", "lib"}) {
+                if (fs::exists(lib_path / dir)) config.build.lib_dirs.push_back((lib_path / dir).string());
+            }
         }
     }
 
-    std::vector<Dependency> PackageManager::fetch_dependencies(const std::vector<Dependency>& deps) {
-        std::vector<Dependency> resolved;
-        if (deps.empty()) return resolved;
+    // Whether locked, an entry of mule.lock, still describes dep as mule.toml declares it.
+    static bool lock_entry_matches(const Dependency& dep, const Dependency& locked) {
+        if (!dep.path.empty()) return locked.path == fs::absolute(dep.path).string();
+        if (locked.git != dep.git || locked.tag != dep.tag || locked.subdir != dep.subdir || locked.commit.empty()) return false;
+        // mule.toml may pin an abbreviated hash
+        return dep.commit.empty() || locked.commit.rfind(dep.commit, 0) == 0;
+    }
+
+    // Fetches and links one level of the dependency graph; resolved keeps the order of deps.
+    static bool fetch_level(const std::vector<Dependency>& deps, const FetchOptions& options,
+                            const std::map<std::string, Dependency>& locked, std::vector<Dependency>& resolved) {
+        if (deps.empty()) return true;
 
         fs::path deps_root = ".mule/deps";
         if (!fs::exists(deps_root))
             fs::create_directories(deps_root);
 
-        for (const auto& dep : deps) {
+        // Slots parallel to deps, so the lockfile keeps the order of mule.toml
+        std::vector<std::optional<Dependency>> results(deps.size());
+        std::vector<size_t> git_deps;
+        bool ok = true;
+        for (size_t i = 0; i < deps.size(); ++i) {
+            const Dependency& dep = deps[i];
             Dependency res = dep;
             fs::path lib_path = deps_root / dep.name;
 
             // 1. Handle Path Dependencies
             if (!dep.path.empty()) {
-                if (fs::exists(lib_path)) fs::remove(lib_path);
                 fs::path target = fs::absolute(dep.path);
                 if (!fs::exists(target)) {
                     std::cerr << "Error: Local dependency '" << dep.name << "' not found at " << target << std::endl;
-                    continue; // Should probably error out hard here
+                    ok = false;
+                    continue;
                 }
+                res.path = target.string();
+                results[i] = res;
+                std::error_code ec;
+                if (fs::is_symlink(lib_path) && fs::read_symlink(lib_path, ec) == target) continue;
+                if (fs::exists(fs::symlink_status(lib_path))) fs::remove_all(lib_path);
                 try {
                     fs::create_directory_symlink(target, lib_path);
                     std::cout << "Linked local dependency: " << dep.name << " -> " << target.string() << std::endl;
                 } catch (...) {
                     fs::copy(target, lib_path, fs::copy_options::recursive);
                 }
-                res.path = target.string();
-                resolved.push_back(res);
-                continue;
+            } else if (!dep.git.empty()) {
+                // Locked and already checked out at the locked commit: nothing to run
+                auto it = locked.find(dep.name);
+                if (it != locked.end() && lock_entry_matches(dep, it->second) && read_git_head(lib_path) == it->second.commit) {
+                    res.commit = it->second.commit;
+                    results[i] = res;
+                    continue;
+                }
+                git_deps.push_back(i);
             }
+        }
+
+        // 2. Handle Git Dependencies, a few at a time, through the shared store
+        std::mutex mtx;
+        size_t next = 0;
+        auto worker = [&]() {
+            while (true) {
+                size_t i;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (next == git_deps.size()) return;
+                    i = git_deps[next++];
+                }
+                const Dependency& dep = deps[i];
+                fs::path lib_path = deps_root / dep.name;
+                Dependency res = dep;
 
-            // 2. Handle Git Dependencies
-            if (!dep.git.empty()) {
-                if (!fs::exists(lib_path)) {
-                    std::cout << "Downloading dependency: " << dep.name << " from " << dep.git << std::endl;
-                    std::string cmd = "git clone " + dep.git + " " + lib_path.string();
-                    if (std::system(cmd.c_str()) != 0) {
-                        std::cerr << "Failed to download " << dep.name << std::endl;
+                // A matching lock entry pins the commit (tags and branches are not re-resolved)
+                Dependency wanted = dep;
+                auto it = locked.find(dep.name);
+                if (it != locked.end() && lock_entry_matches(dep, it->second)) {
+                    wanted.commit = it->second.commit;
+                    wanted.tag.clear();
+                } else if (!options.update && dep.tag.empty() && dep.commit.empty()) {
+                    // Unpinned dependencies are not updated once they are there
+                    std::string head = read_git_head(lib_path);
+                    if (fs::is_symlink(lib_path) && !head.empty()) {
+                        res.commit = head;
+                        results[i] = res;
                         continue;
                     }
                 }
 
-                if (!dep.tag.empty() || !dep.commit.empty()) {
-                    std::string target = dep.tag.empty() ? dep.commit : dep.tag;
-                    std::string cwd = fs::current_path().string();
-                    fs::current_path(lib_path);
-                    std::system(("git checkout " + target + " > /dev/null 2>&1").c_str());
-                    fs::current_path(cwd);
+                std::string checkout, log;
+                bool fetched = false;
+                std::error_code ec;
+                if (!Store::materialize(wanted, options.offline, options.update, res.commit, checkout, fetched, log)) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    std::cerr << "Failed to download " << dep.name << "\n" << log << std::flush;
+                    ok = false;
+                    continue;
+                }
+                if (!fs::is_symlink(lib_path) || fs::read_symlink(lib_path, ec) != checkout) {
+                    fs::remove_all(lib_path, ec);
+                    fs::create_directory_symlink(checkout, lib_path, ec);
+                }
+
+                std::lock_guard<std::mutex> lock(mtx);
+                if (ec) {
+                    std::cerr << "Error: could not link " << lib_path.string() << " to " << checkout << ": " << ec.message() << std::endl;
+                    ok = false;
+                    continue;
+                }
+                if (fetched) std::cout << "Downloaded dependency: " << dep.name << " from " << dep.git << std::endl;
+                results[i] = res;
+            }
+        };
+        size_t worker_count = std::min<size_t>(git_deps.size(), 8);
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < worker_count; ++w) workers.emplace_back(worker);
+        for (auto& t : workers) t.join();
+        if (!git_deps.empty()) Store::register_project(fs::current_path().string());
+
+        for (auto& result : results) {
+            if (result) resolved.push_back(*result);
+        }
+        return ok;
+    }
+
+    static void report_stale_lock(const std::vector<std::string>& stale) {
+        std::cerr << "Error: mule.lock does not match mule.toml (";
+        for (size_t i = 0; i < stale.size(); ++i) std::cerr << (i ? ", " : "") << stale[i];
+        std::cerr << ") and --locked forbids updating it; run 'mule fetch'." << std::endl;
+    }
+
+    // Where a dependency comes from; two requests for one name must agree on it.
+    static std::string source_of(const Dependency& dep) {
+        if (!dep.path.empty()) return "path " + dep.path;
+        std::string source = "git " + dep.git;
+        if (!dep.tag.empty()) source += " tag " + dep.tag;
+        if (!dep.commit.empty()) source += " commit " + dep.commit;
+        if (!dep.subdir.empty()) source += " subdir " + dep.subdir;
+        return source;
+    }
+
+    // "1.2" accepts 1.2 and 1.2.x, "1" accepts any 1.x.
+    static bool version_matches(const std::string& required, const std::string& version) {
+        if (required.empty() || required == "*") return true;
+        return version == required || version.rfind(required + ".", 0) == 0;
+    }
+
+    static fs::path manifest_of(const std::string& name) {
+        return fs::path(".mule/deps") / name / "mule.toml";
+    }
+
+    bool PackageManager::fetch_dependencies(const std::vector<Dependency>& deps, const FetchOptions& options,
+                                            std::vector<Dependency>& resolved) {
+        resolved.clear();
+
+        // Entries of mule.lock by name; a lockfile without an entry for every dependency (or
+        // with stale ones) is rewritten afterwards, which --locked forbids
+        std::map<std::string, Dependency> locked;
+        bool lock_exists = fs::exists("mule.lock");
+        if (lock_exists && !options.update) {
+            try {
+                for (const auto& entry : ConfigParser::parse("mule.lock").dependencies) locked[entry.name] = entry;
+            } catch (const std::exception& e) {
+                std::cerr << "Error: mule.lock is invalid (" << e.what() << "); run 'mule fetch --update' to re-resolve it." << std::endl;
+                return false;
+            }
+        }
+        if (options.locked && (!lock_exists || options.update)) {
+            std::cerr << "Error: --locked needs an up to date mule.lock; run 'mule fetch' first." << std::endl;
+            return false;
+        }
+
+        // Dependencies that are Mule projects bring their own [dependencies], fetched into
+        // the same .mule/deps level by level. Every name is fetched once; requests that
+        // disagree on its source are a conflict, unless mule.toml itself declares it.
+        struct Request {
+            Dependency dep;
+            std::string requester; // Package whose mule.toml asked for it, empty for the project
+        };
+        std::map<std::string, Request> requested;
+        std::vector<Request> versioned; // Requests with a version requirement, checked once fetched
+        std::vector<Dependency> level;
+        for (Dependency dep : deps) {
+            if (!dep.path.empty()) dep.path = fs::absolute(dep.path).string();
+            requested[dep.name] = {dep, ""};
+            if (!dep.version.empty()) versioned.push_back({dep, ""});
+            level.push_back(dep);
+        }
+
+        bool ok = true;
+        std::map<std::string, Config> manifests;
+        while (!level.empty()) {
+            if (options.locked) {
+                std::vector<std::string> stale;
+                for (const auto& dep : level) {
+                    auto it = locked.find(dep.name);
+                    if (it == locked.end() || !lock_entry_matches(dep, it->second)) stale.push_back(dep.name);
+                }
+                if (!stale.empty()) {
+                    report_stale_lock(stale);
+                    return false;
+                }
+            }
+
+            std::vector<Dependency> fetched;
+            if (!fetch_level(level, options, locked, fetched)) ok = false;
+            resolved.insert(resolved.end(), fetched.begin(), fetched.end());
+
+            std::vector<Dependency> next;
+            for (const auto& package : fetched) {
+                fs::path manifest = manifest_of(package.name);
+                if (!fs::exists(manifest)) continue;
+                try {
+                    manifests[package.name] = ConfigParser::parse(manifest.string());
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: the mule.toml of dependency '" << package.name << "' is invalid: " << e.what() << std::endl;
+                    ok = false;
+                    continue;
+                }
+                const Config& config = manifests[package.name];
+                std::error_code ec;
+                fs::path root = fs::canonical(manifest.parent_path(), ec);
+                for (Dependency dep : config.dependencies) {
+                    // Paths in a dependency's mule.toml are relative to that dependency
+                    if (!dep.path.empty()) dep.path = (root / dep.path).lexically_normal().string();
+                    if (!dep.version.empty()) versioned.push_back({dep, package.name});
+                    auto it = requested.find(dep.name);
+                    if (it == requested.end()) {
+                        requested[dep.name] = {dep, package.name};
+                        next.push_back(dep);
+                    } else if (source_of(it->second.dep) != source_of(dep)) {
+                        std::string first = it->second.requester.empty() ? "mule.toml" : it->second.requester;
+                        if (it->second.requester.empty()) {
+                            std::cerr << "Warning: " << package.name << " wants " << dep.name << " from " << source_of(dep)
+                                      << ", using " << source_of(it->second.dep) << " from mule.toml." << std::endl;
+                            continue;
+                        }
+                        std::cerr << "Error: conflicting requirements for " << dep.name << ": " << first << " wants "
+                                  << source_of(it->second.dep) << ", " << package.name << " wants " << source_of(dep)
+                                  << ". Declare " << dep.name << " in mule.toml to choose one." << std::endl;
+                        ok = false;
+                    }
                 }
-                
-                // Always get the resolved commit hash
-                res.commit = get_git_head(lib_path);
-                resolved.push_back(res);
             }
+            level = next;
         }
-        return resolved;
+
+        for (const auto& request : versioned) {
+            auto manifest = manifests.find(request.dep.name);
+            if (manifest == manifests.end()) continue;
+            const std::string& version = manifest->second.version;
+            if (version_matches(request.dep.version, version)) continue;
+            std::cerr << "Error: " << (request.requester.empty() ? "mule.toml" : request.requester) << " requires "
+                      << request.dep.name << " " << request.dep.version << ", but " << source_of(requested[request.dep.name].dep)
+                      << " is version " << (version.empty() ? "(none)" : version) << "." << std::endl;
+            ok = false;
+        }
+
+        if (options.locked) {
+            std::vector<std::string> stale;
+            for (const auto& [name, entry] : locked) {
+                if (!requested.count(name)) stale.push_back(name);
+            }
+            if (!stale.empty()) {
+                report_stale_lock(stale);
+                return false;
+            }
+        }
+        return ok;
+    }
+
+    bool PackageManager::mule_packages(const std::vector<Dependency>& resolved, std::vector<MulePackage>& out) {
+        out.clear();
+        std::map<std::string, MulePackage> packages;
+        for (const auto& dep : resolved) {
+            fs::path manifest = manifest_of(dep.name);
+            if (!fs::exists(manifest)) continue;
+            MulePackage package;
+            package.name = dep.name;
+            package.path = manifest.parent_path().string();
+            try {
+                package.config = ConfigParser::parse(manifest.string());
+            } catch (const std::exception& e) {
+                std::cerr << "Error: the mule.toml of dependency '" << dep.name << "' is invalid: " << e.what() << std::endl;
+                return false;
+            }
+            packages[dep.name] = package;
+        }
+        for (auto& [name, package] : packages) {
+            for (const auto& dep : package.config.dependencies) {
+                if (packages.count(dep.name)) package.dependencies.push_back(dep.name);
+            }
+        }
+
+        // Depth-first, emitting a package once everything it depends on has been
+        std::map<std::string, int> state; // 1 = on the current path, 2 = emitted
+        std::vector<std::string> path;
+        std::function<bool(const std::string&)> visit = [&](const std::string& name) {
+            if (state[name] == 2) return true;
+            if (state[name] == 1) {
+                std::cerr << "Error: dependency cycle:";
+                for (auto it = std::find(path.begin(), path.end(), name); it != path.end(); ++it) std::cerr << " " << *it << " ->";
+                std::cerr << " " << name << std::endl;
+                return false;
+            }
+            state[name] = 1;
+            path.push_back(name);
+            for (const auto& dep : packages[name].dependencies) {
+                if (!visit(dep)) return false;
+            }
+            path.pop_back();
+            state[name] = 2;
+            out.push_back(packages[name]);
+            return true;
+        };
+        for (const auto& dep : resolved) {
+            if (packages.count(dep.name) && !visit(dep.name)) return false;
+        }
+        return true;
     }
 
     void PackageManager::write_lockfile(const std::vector<Dependency>& resolved) {
-        std::ofstream lock("mule.lock");
+        std::ostringstream lock;
         lock << "# Verified dependency snapshots\n\n";
         
         lock << "[dependencies]\n";
@@ -132,9 +886,27 @@ namespace mule {
             } else {
                 lock << "git = \"" << dep.git << "\", commit = \"" << dep.commit << "\"";
                 if (!dep.tag.empty()) lock << ", tag = \"" << dep.tag << "\"";
+                if (!dep.subdir.empty()) lock << ", subdir = \"" << dep.subdir << "\"";
             }
             lock << " }\n";
         }
-        lock.close();
+
+        // Leave an unchanged lockfile alone so its mtime (and anything keyed on it) stays put
+        std::ifstream existing("mule.lock", std::ios::binary);
+        std::string existing_content((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+        existing.close();
+        if (existing_content == lock.str()) return;
+        // Through a rename, so an interrupted write never leaves half a lockfile
+        std::error_code ec;
+        {
+            std::ofstream out("mule.lock.tmp", std::ios::trunc);
+            out << lock.str();
+            if (!out) ec = std::make_error_code(std::errc::io_error);
+        }
+        if (!ec) fs::rename("mule.lock.tmp", "mule.lock", ec);
+        if (ec) {
+            std::cerr << "Warning: could not write mule.lock: " << ec.message() << std::endl;
+            fs::remove("mule.lock.tmp", ec);
+        }
     }
 }
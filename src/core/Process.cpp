@@ -0,0 +1,214 @@
+#include "../../include/core/Process.h"
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+extern char** environ;
+#endif
+
+namespace mule {
+
+#ifdef _WIN32
+    const size_t Process::RESPONSE_FILE_THRESHOLD = 8000; // cmd.exe stops at 8191 characters
+#else
+    const size_t Process::RESPONSE_FILE_THRESHOLD = 100000; // Well below ARG_MAX with any environment
+#endif
+
+    std::vector<std::string> Process::split(const std::string& command) {
+        std::vector<std::string> args;
+        std::string current;
+        bool in_word = false;
+        char quote_char = 0;
+
+        for (size_t i = 0; i < command.size(); ++i) {
+            char c = command[i];
+            if (quote_char) {
+                if (c == quote_char) {
+                    quote_char = 0;
+                } else if (c == '\\' && quote_char == '"' && i + 1 < command.size() &&
+                           (command[i + 1] == '"' || command[i + 1] == '\\')) {
+                    current += command[++i];
+                } else {
+                    current += c;
+                }
+            } else if (c == '"' || c == '\'') {
+                quote_char = c;
+                in_word = true;
+            } else if (c == '\\' && i + 1 < command.size()) {
+                current += command[++i];
+                in_word = true;
+            } else if (isspace(static_cast<unsigned char>(c))) {
+                if (in_word) args.push_back(current);
+                current.clear();
+                in_word = false;
+            } else {
+                current += c;
+                in_word = true;
+            }
+        }
+        if (in_word) args.push_back(current);
+        return args;
+    }
+
+    std::string Process::quote(const std::string& arg) {
+        if (arg.empty()) return "\"\"";
+        bool safe = true;
+        for (char c : arg) {
+            if (!(isalnum(static_cast<unsigned char>(c)) || std::string("-_./=:,+@%").find(c) != std::string::npos)) {
+                safe = false;
+                break;
+            }
+        }
+        if (safe) return arg;
+
+        std::string quoted = "\"";
+        for (char c : arg) {
+            if (c == '"' || c == '\\') quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    bool Process::needs_shell(const std::string& command) {
+        char quote_char = 0;
+        for (size_t i = 0; i < command.size(); ++i) {
+            char c = command[i];
+            if (quote_char) {
+                if (c == quote_char) quote_char = 0;
+                else if (quote_char == '"' && (c == '$' || c == '`')) return true;
+            } else if (c == '"' || c == '\'') {
+                quote_char = c;
+            } else if (c == '\\') {
+                ++i;
+            } else if (std::string("|&;<>()$`*?[~").find(c) != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ProcessResult Process::run(const std::string& command, const ProcessOptions& options) {
+        if (needs_shell(command)) {
+#ifdef _WIN32
+            return run(std::vector<std::string>{"cmd", "/c", command}, options);
+#else
+            return run(std::vector<std::string>{"/bin/sh", "-c", command}, options);
+#endif
+        }
+        return run(split(command), options);
+    }
+
+    // Moves everything after the program name into a response file if the command line is
+    // too long. GCC, Clang, MSVC and binutils all accept @file arguments.
+    static std::vector<std::string> apply_response_file(const std::vector<std::string>& args, const std::string& rsp_path) {
+        if (rsp_path.empty() || args.size() < 2) return args;
+        // The shell would run "@file" as a script; its command line has to stay one argument
+        if (args[0] == "/bin/sh" || args[0] == "cmd") return args;
+        size_t length = 0;
+        for (const auto& arg : args) length += arg.size() + 1;
+        if (length <= Process::RESPONSE_FILE_THRESHOLD) return args;
+
+        std::ofstream rsp(rsp_path, std::ios::trunc);
+        for (size_t i = 1; i < args.size(); ++i) rsp << Process::quote(args[i]) << "\n";
+        if (!rsp) return args;
+        return {args[0], "@" + rsp_path};
+    }
+
+#ifdef _WIN32
+    ProcessResult Process::run(const std::vector<std::string>& args, const ProcessOptions& options) {
+        ProcessResult result;
+        if (args.empty()) return result;
+        std::vector<std::string> argv = apply_response_file(args, options.response_file);
+
+        std::string command;
+        for (const auto& arg : argv) command += quote(arg) + " ";
+        if (!options.cwd.empty()) command = "cd /d " + quote(options.cwd) + " && " + command;
+
+        auto start = std::chrono::steady_clock::now();
+        if (!options.capture) {
+            result.exit_code = std::system(command.c_str());
+        } else {
+            if (options.merge_stderr) command += "2>&1";
+            FILE* pipe = _popen(command.c_str(), "r");
+            if (!pipe) return result;
+            char buffer[4096];
+            size_t n;
+            while ((n = fread(buffer, 1, sizeof buffer, pipe)) > 0) result.output.append(buffer, n);
+            result.exit_code = _pclose(pipe);
+        }
+        result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+#else
+    ProcessResult Process::run(const std::vector<std::string>& args, const ProcessOptions& options) {
+        ProcessResult result;
+        if (args.empty()) return result;
+        std::vector<std::string> argv_strings = apply_response_file(args, options.response_file);
+        std::vector<char*> argv;
+        for (auto& arg : argv_strings) argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+
+        // The pipe is close-on-exec so children spawned concurrently by other workers do not
+        // inherit it and keep it open past this child's exit
+        int pipe_fds[2] = {-1, -1};
+        if (options.capture && pipe2(pipe_fds, O_CLOEXEC) != 0) return result;
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        if (options.capture) {
+            posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+            if (options.merge_stderr) posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDERR_FILENO);
+        }
+        if (!options.cwd.empty()) posix_spawn_file_actions_addchdir_np(&actions, options.cwd.c_str());
+
+        auto start = std::chrono::steady_clock::now();
+        pid_t pid;
+        int spawn_error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (options.capture) close(pipe_fds[1]);
+
+        if (spawn_error != 0) {
+            if (options.capture) close(pipe_fds[0]);
+            result.output = std::string(args[0]) + ": " + strerror(spawn_error) + "\n";
+            return result;
+        }
+
+        if (options.capture) {
+            char buffer[4096];
+            while (true) {
+                ssize_t n = read(pipe_fds[0], buffer, sizeof buffer);
+                if (n > 0) result.output.append(buffer, n);
+                else if (n == 0 || errno != EINTR) break;
+            }
+            close(pipe_fds[0]);
+        }
+
+        int status = 0;
+        struct rusage usage{};
+        while (wait4(pid, &status, 0, &usage) < 0) {
+            if (errno != EINTR) return result;
+        }
+        result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.cpu_ms = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+                        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#ifdef __APPLE__
+        result.peak_rss_kb = usage.ru_maxrss / 1024; // Bytes on macOS
+#else
+        result.peak_rss_kb = usage.ru_maxrss;
+#endif
+        result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        return result;
+    }
+#endif
+}
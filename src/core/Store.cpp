@@ -0,0 +1,262 @@
+#include "../../include/core/Store.h"
+#include "../../include/core/Timings.h"
+#include "../../include/core/Utils.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <set>
+#include <cctype>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    std::string Store::root() {
+        if (const char* mule_home = std::getenv("MULE_HOME")) return (fs::path(mule_home) / "store").string();
+#ifdef _WIN32
+        const char* home = std::getenv("USERPROFILE");
+#else
+        const char* home = std::getenv("HOME");
+#endif
+        if (!home) return (fs::temp_directory_path() / "mule-store").string();
+        return (fs::path(home) / ".mule" / "store").string();
+    }
+
+    // https://host/org/repo, https://host/org/repo/ and https://host/org/repo.git share a mirror
+    static std::string mirror_key(std::string url) {
+        while (!url.empty() && url.back() == '/') url.pop_back();
+        if (url.size() > 4 && url.compare(url.size() - 4, 4, ".git") == 0) url.resize(url.size() - 4);
+        return to_hex(hash_string(url));
+    }
+
+    static std::string worktree_name(const std::string& commit, const std::string& subdir) {
+        if (subdir.empty()) return commit;
+        return commit + "-" + to_hex(hash_string(subdir)).substr(0, 8);
+    }
+
+    // Runs git in dir with its output captured.
+    static ProcessResult run_git(const fs::path& dir, const std::vector<std::string>& args, const std::string& name, std::string& log) {
+        std::vector<std::string> command = {"git"};
+        command.insert(command.end(), args.begin(), args.end());
+        std::string step;
+        for (const auto& arg : command) step += (step.empty() ? "" : " ") + arg;
+        ProcessOptions options;
+        options.cwd = dir.string();
+        ProcessResult result = Timings::run(step + " (" + name + ")", "fetch", command, options);
+        log += "$ " + step + "\n" + result.output;
+        return result;
+    }
+
+    static bool git(const fs::path& dir, const std::vector<std::string>& args, const std::string& name, std::string& log) {
+        return run_git(dir, args, name, log).exit_code == 0;
+    }
+
+    // The full hash of the commit rev names in repo, if repo has it.
+    static bool resolve_commit(const fs::path& repo, const std::string& rev, const std::string& name, std::string& out_commit, std::string& log) {
+        ProcessResult result = run_git(repo, {"rev-parse", "-q", "--verify", rev + "^{commit}"}, name, log);
+        if (result.exit_code != 0) return false;
+        out_commit = result.output;
+        while (!out_commit.empty() && isspace(static_cast<unsigned char>(out_commit.back()))) out_commit.pop_back();
+        return !out_commit.empty();
+    }
+
+    // Brings dep's revision into its mirror. Only the wanted commit is fetched, without
+    // history and with blobs downloaded on demand, so a sparse worktree only downloads its
+    // own files. Servers that cannot serve a single commit (or abbreviated hashes) get a
+    // full fetch instead.
+    static bool fetch_into_mirror(const fs::path& mirror, const Dependency& dep, std::string& out_commit, std::string& log) {
+        std::string rev = dep.tag.empty() ? dep.commit : dep.tag;
+        // --force: a tag that moved upstream replaces the mirror's copy
+        std::vector<std::string> shallow = {"fetch", "-q", "--force", "--depth", "1", "--filter=blob:none", "origin"};
+        if (rev.empty()) shallow.push_back("HEAD");
+        else if (!dep.tag.empty()) shallow.insert(shallow.end(), {"tag", dep.tag});
+        else shallow.push_back(dep.commit);
+        if (git(mirror, shallow, dep.name, log) && resolve_commit(mirror, rev.empty() ? "FETCH_HEAD" : rev, dep.name, out_commit, log)) {
+            return true;
+        }
+
+        std::vector<std::string> full = {"fetch", "-q", "--force", "--filter=blob:none", "--tags", "origin"};
+        if (fs::exists(mirror / "shallow")) full.push_back("--unshallow");
+        if (!git(mirror, full, dep.name, log)) return false;
+        if (rev.empty() && !git(mirror, {"remote", "set-head", "origin", "--auto"}, dep.name, log)) return false;
+        return resolve_commit(mirror, rev.empty() ? "origin/HEAD" : rev, dep.name, out_commit, log);
+    }
+
+    bool Store::materialize(const Dependency& dep, bool offline, bool update, std::string& out_commit, std::string& out_checkout, bool& fetched,
+                            std::string& log) {
+        fs::path store = root();
+        std::string key = mirror_key(dep.git);
+        fs::path mirror = store / "mirrors" / (key + ".git");
+        std::error_code ec;
+        fs::create_directories(store / "mirrors", ec);
+        if (ec) {
+            log += "cannot create " + (store / "mirrors").string() + ": " + ec.message() + "\n";
+            return false;
+        }
+        FileLock lock((store / "mirrors" / (key + ".lock")).string());
+
+        fetched = false;
+        if (offline && !fs::exists(mirror / "HEAD")) {
+            log += dep.git + " has not been fetched into the store, cannot fetch it offline\n";
+            return false;
+        }
+        if (!fs::exists(mirror / "HEAD")) {
+            fs::remove_all(mirror, ec); // Left over from an interrupted first fetch
+            fs::create_directories(mirror, ec);
+            if (!git(mirror, {"init", "-q", "--bare"}, dep.name, log) || !git(mirror, {"remote", "add", "origin", dep.git}, dep.name, log)) {
+                fs::remove_all(mirror, ec);
+                return false;
+            }
+        }
+
+        // Pinned revisions another project already fetched need no network, except tags on
+        // update, which may have moved
+        std::string rev = dep.tag.empty() ? dep.commit : dep.tag;
+        std::string commit;
+        bool refetch_tag = update && !offline && !dep.tag.empty();
+        if (rev.empty() || refetch_tag || !resolve_commit(mirror, rev, dep.name, commit, log)) {
+            if (offline) {
+                log += (rev.empty() ? "the default branch of " + dep.git : rev) + " is not in the store, cannot fetch it offline\n";
+                return false;
+            }
+            fetched = true;
+            if (!fetch_into_mirror(mirror, dep, commit, log)) return false;
+        }
+
+        fs::path worktree = store / "worktrees" / key / worktree_name(commit, dep.subdir);
+        if (!fs::exists(worktree / ".git")) {
+            fs::remove_all(worktree, ec);
+            git(mirror, {"worktree", "prune"}, dep.name, log);
+            fs::create_directories(worktree.parent_path(), ec);
+            bool added;
+            if (dep.subdir.empty()) {
+                added = git(mirror, {"worktree", "add", "-q", "--detach", worktree.string(), commit}, dep.name, log);
+            } else {
+                added = git(mirror, {"worktree", "add", "-q", "--detach", "--no-checkout", worktree.string(), commit}, dep.name, log) &&
+                        git(worktree, {"sparse-checkout", "set", "--", dep.subdir}, dep.name, log) &&
+                        git(worktree, {"checkout", "-q", "--detach", commit}, dep.name, log);
+            }
+            if (!added) {
+                fs::remove_all(worktree, ec);
+                git(mirror, {"worktree", "prune"}, dep.name, log);
+                return false;
+            }
+        }
+
+        fs::path checkout = dep.subdir.empty() ? worktree : worktree / dep.subdir;
+        if (!fs::is_directory(checkout)) {
+            log += "'" + dep.subdir + "' is not a directory in " + dep.git + " at " + commit + "\n";
+            return false;
+        }
+        out_commit = commit;
+        out_checkout = checkout.string();
+        return true;
+    }
+
+    void Store::register_project(const std::string& project_dir) {
+        std::string path = fs::absolute(project_dir).lexically_normal().string();
+        fs::path entry = fs::path(root()) / "projects" / to_hex(hash_string(path));
+        if (fs::exists(entry)) return;
+        std::error_code ec;
+        fs::create_directories(entry.parent_path(), ec);
+        std::ofstream(entry) << path << "\n";
+    }
+
+    static uint64_t tree_size(const fs::path& dir) {
+        uint64_t size = 0;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(dir, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) break;
+            if (it->is_regular_file(ec) && !it->is_symlink(ec)) size += it->file_size(ec);
+        }
+        return size;
+    }
+
+    int Store::gc() {
+        fs::path store = root();
+        if (!fs::exists(store)) {
+            std::cout << "Store " << store.string() << " is empty." << std::endl;
+            return 0;
+        }
+
+        // Worktrees ("<mirror key>/<name>") that some registered lockfile pins
+        std::set<std::string> referenced;
+        size_t projects = 0, forgotten = 0;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(store / "projects", ec)) {
+            std::ifstream file(entry.path());
+            std::string project;
+            std::getline(file, project);
+            file.close();
+            fs::path lockfile = fs::path(project) / "mule.lock";
+            if (project.empty() || !fs::exists(lockfile)) {
+                fs::remove(entry.path(), ec);
+                ++forgotten;
+                continue;
+            }
+            ++projects;
+            try {
+                for (const auto& dep : ConfigParser::parse(lockfile.string()).dependencies) {
+                    if (dep.git.empty() || dep.commit.empty()) continue;
+                    referenced.insert(mirror_key(dep.git) + "/" + worktree_name(dep.commit, dep.subdir));
+                }
+            } catch (const std::exception& e) {
+                // Keep at least what the project's .mule/deps links to
+                std::cerr << "Warning: skipping " << project << ": " << e.what() << std::endl;
+                fs::path worktrees = store / "worktrees";
+                for (const auto& link : fs::directory_iterator(fs::path(project) / ".mule" / "deps", ec)) {
+                    if (!link.is_symlink(ec)) continue;
+                    fs::path relative = fs::read_symlink(link.path(), ec).lexically_relative(worktrees);
+                    auto it = relative.begin();
+                    if (ec || relative.empty() || *it == "..") continue;
+                    std::string key = (it++)->string();
+                    if (it != relative.end()) referenced.insert(key + "/" + it->string());
+                }
+            }
+        }
+
+        size_t worktrees_removed = 0, mirrors_removed = 0;
+        uint64_t freed = 0;
+        for (const auto& entry : fs::directory_iterator(store / "mirrors", ec)) {
+            if (entry.path().extension() != ".git") continue;
+            std::string key = entry.path().stem().string();
+            fs::path mirror = entry.path();
+            fs::path worktrees = store / "worktrees" / key;
+            FileLock lock((store / "mirrors" / (key + ".lock")).string());
+            std::string log;
+
+            size_t kept = 0, removed = 0;
+            for (const auto& worktree : fs::directory_iterator(worktrees, ec)) {
+                if (referenced.count(key + "/" + worktree.path().filename().string())) {
+                    ++kept;
+                    continue;
+                }
+                freed += tree_size(worktree.path());
+                fs::remove_all(worktree.path(), ec);
+                ++removed;
+            }
+            worktrees_removed += removed;
+
+            if (kept == 0) {
+                freed += tree_size(mirror);
+                fs::remove_all(mirror, ec);
+                fs::remove_all(worktrees, ec);
+                ++mirrors_removed;
+            } else if (removed > 0) {
+                // Drop the objects only the removed commits needed
+                git(mirror, {"worktree", "prune"}, key, log);
+                uint64_t before = tree_size(mirror);
+                git(mirror, {"gc", "-q", "--prune=now"}, key, log);
+                uint64_t after = tree_size(mirror);
+                if (before > after) freed += before - after;
+            }
+        }
+
+        std::cout << "Removed " << worktrees_removed << " worktree(s) and " << mirrors_removed << " mirror(s), freed "
+                  << (freed + 512 * 1024) / (1024 * 1024) << " MiB. " << referenced.size() << " worktree(s) still used by "
+                  << projects << " project(s)";
+        if (forgotten > 0) std::cout << "; forgot " << forgotten << " project(s) without a mule.lock";
+        std::cout << "." << std::endl;
+        return 0;
+    }
+}
@@ -0,0 +1,300 @@
+#include "../../include/core/Timings.h"
+#include "../../include/core/Json.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    namespace {
+        struct Recorder {
+            bool enabled = false;
+            std::chrono::steady_clock::time_point start;
+            std::vector<TimingEvent> events;
+            std::mutex mtx;
+        };
+
+        Recorder& recorder() {
+            static Recorder instance;
+            return instance;
+        }
+
+        struct HistoryEntry {
+            long long timestamp = 0;
+            double total_ms = 0;
+            double critical_ms = 0;
+            size_t steps = 0;
+            bool success = false;
+        };
+    }
+
+    void Timings::begin() {
+        Recorder& rec = recorder();
+        std::lock_guard<std::mutex> lock(rec.mtx);
+        rec.enabled = true;
+        rec.start = std::chrono::steady_clock::now();
+        rec.events.clear();
+    }
+
+    bool Timings::enabled() {
+        return recorder().enabled;
+    }
+
+    double Timings::now_ms() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recorder().start).count();
+    }
+
+    size_t Timings::record(const TimingEvent& event) {
+        Recorder& rec = recorder();
+        std::lock_guard<std::mutex> lock(rec.mtx);
+        if (!rec.enabled) return 0;
+        rec.events.push_back(event);
+        return rec.events.size() - 1;
+    }
+
+    ProcessResult Timings::run(const std::string& name, const std::string& category,
+                               const std::vector<std::string>& args, const ProcessOptions& options) {
+        double start = now_ms();
+        ProcessResult result = Process::run(args, options);
+        if (enabled()) record({name, category, 0, start, result.wall_ms, result.cpu_ms, result.peak_rss_kb, {}});
+        return result;
+    }
+
+    ProcessResult Timings::run(const std::string& name, const std::string& category,
+                               const std::string& command, const ProcessOptions& options) {
+        double start = now_ms();
+        ProcessResult result = Process::run(command, options);
+        if (enabled()) record({name, category, 0, start, result.wall_ms, result.cpu_ms, result.peak_rss_kb, {}});
+        return result;
+    }
+
+    // Walks back from the step that finished last. A step's predecessor is the dependency
+    // that finished last or, for steps without explicit dependencies, whatever finished
+    // last before it started (the previous main-thread step or the job that freed its slot).
+    static std::vector<size_t> critical_path(const std::vector<TimingEvent>& events) {
+        std::vector<size_t> path;
+        if (events.empty()) return path;
+        auto end_of = [&](size_t i) { return events[i].start_ms + events[i].duration_ms; };
+
+        size_t current = 0;
+        for (size_t i = 1; i < events.size(); ++i) {
+            if (end_of(i) > end_of(current)) current = i;
+        }
+        while (true) {
+            path.push_back(current);
+            const TimingEvent& event = events[current];
+            bool found = false;
+            size_t best = 0;
+            if (!event.deps.empty()) {
+                for (size_t dep : event.deps) {
+                    if (!found || end_of(dep) > end_of(best)) best = dep;
+                    found = true;
+                }
+            } else {
+                for (size_t i = 0; i < events.size(); ++i) {
+                    if (i == current || end_of(i) > event.start_ms + 0.5) continue;
+                    if (!found || end_of(i) > end_of(best)) best = i;
+                    found = true;
+                }
+            }
+            if (!found || std::find(path.begin(), path.end(), best) != path.end()) break;
+            current = best;
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    static std::vector<HistoryEntry> load_history() {
+        std::vector<HistoryEntry> history;
+        std::ifstream in(Timings::HISTORY_PATH);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream ss(line);
+            HistoryEntry entry;
+            int success = 0;
+            if (ss >> entry.timestamp >> entry.total_ms >> entry.critical_ms >> entry.steps >> success) {
+                entry.success = success != 0;
+                history.push_back(entry);
+            }
+        }
+        return history;
+    }
+
+    static void save_history(std::vector<HistoryEntry> history) {
+        if (history.size() > Timings::HISTORY_LIMIT) history.erase(history.begin(), history.end() - Timings::HISTORY_LIMIT);
+        fs::create_directories(fs::path(Timings::HISTORY_PATH).parent_path());
+        std::ofstream out(Timings::HISTORY_PATH, std::ios::trunc);
+        for (const auto& entry : history) {
+            out << entry.timestamp << " " << entry.total_ms << " " << entry.critical_ms << " "
+                << entry.steps << " " << (entry.success ? 1 : 0) << "\n";
+        }
+    }
+
+    static std::string format_ms(double ms) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(ms < 10 ? 1 : 0) << ms << " ms";
+        return ss.str();
+    }
+
+    static std::string html_escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            switch (c) {
+                case '<': out += "&lt;"; break;
+                case '>': out += "&gt;"; break;
+                case '&': out += "&amp;"; break;
+                case '"': out += "&quot;"; break;
+                default: out += c;
+            }
+        }
+        return out;
+    }
+
+    static void write_trace(const std::vector<TimingEvent>& events, int slots) {
+        std::ofstream out(Timings::TRACE_PATH, std::ios::trunc);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        // Separators go before every element but the first: the event list may be empty
+        for (int slot = 0; slot <= slots; ++slot) {
+            out << (slot > 0 ? ",\n" : "") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << slot << ",\"args\":{\"name\":"
+                << JsonValue::quote(slot == 0 ? "mule" : "worker " + std::to_string(slot)) << "}}";
+        }
+        for (size_t i = 0; i < events.size(); ++i) {
+            const TimingEvent& event = events[i];
+            out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << event.slot
+                << ",\"name\":" << JsonValue::quote(event.name) << ",\"cat\":" << JsonValue::quote(event.category)
+                << ",\"ts\":" << static_cast<long long>(event.start_ms * 1000)
+                << ",\"dur\":" << static_cast<long long>(event.duration_ms * 1000)
+                << ",\"args\":{\"cpu_ms\":" << event.cpu_ms << ",\"peak_rss_kb\":" << event.peak_rss_kb << "}}";
+        }
+        out << "\n]}\n";
+    }
+
+    static void write_report(const std::vector<TimingEvent>& events, const std::vector<size_t>& slowest,
+                             const std::vector<size_t>& path, const std::vector<HistoryEntry>& history,
+                             double total_ms, int slots) {
+        std::ofstream out(Timings::REPORT_PATH, std::ios::trunc);
+        out << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>mule build timings</title>\n"
+            << "<style>body{font-family:sans-serif;margin:2em}table{border-collapse:collapse}"
+            << "td,th{padding:2px 10px;text-align:left;border-bottom:1px solid #ddd}"
+            << ".lane{position:relative;height:22px;background:#f4f4f4;margin:2px 0}"
+            << ".bar{position:absolute;height:20px;top:1px;overflow:hidden;font-size:11px;white-space:nowrap;color:#fff}"
+            << ".compile{background:#4a7ebb}.link{background:#b5473a}.dependency{background:#6a9a48}"
+            << ".generate{background:#c38d2c}.pch{background:#7b5ea7}.probe,.fetch{background:#888}</style></head><body>\n";
+        out << "<h1>Build timings</h1>\n<p>Total: " << format_ms(total_ms) << ", " << events.size()
+            << " steps, " << slots << " worker(s).</p>\n";
+
+        out << "<h2>Timeline</h2>\n";
+        for (int slot = 0; slot <= slots; ++slot) {
+            out << "<div class=\"lane\" title=\"" << (slot == 0 ? "mule" : "worker " + std::to_string(slot)) << "\">";
+            for (const auto& event : events) {
+                if (event.slot != slot || total_ms <= 0) continue;
+                out << "<div class=\"bar " << html_escape(event.category) << "\" style=\"left:"
+                    << event.start_ms * 100 / total_ms << "%;width:" << std::max(event.duration_ms * 100 / total_ms, 0.1)
+                    << "%\" title=\"" << html_escape(event.name) << " (" << format_ms(event.duration_ms) << ")\">"
+                    << html_escape(event.name) << "</div>";
+            }
+            out << "</div>\n";
+        }
+
+        out << "<h2>Slowest steps</h2>\n<table><tr><th>Duration</th><th>CPU</th><th>Peak RSS</th><th>Kind</th><th>Step</th></tr>\n";
+        for (size_t i : slowest) {
+            const TimingEvent& event = events[i];
+            out << "<tr><td>" << format_ms(event.duration_ms) << "</td><td>" << format_ms(event.cpu_ms) << "</td><td>"
+                << event.peak_rss_kb / 1024 << " MB</td><td>" << html_escape(event.category) << "</td><td>"
+                << html_escape(event.name) << "</td></tr>\n";
+        }
+        out << "</table>\n";
+
+        out << "<h2>Critical path</h2>\n<ol>\n";
+        for (size_t i : path) {
+            out << "<li>" << html_escape(events[i].name) << " (" << format_ms(events[i].duration_ms) << ")</li>\n";
+        }
+        out << "</ol>\n";
+
+        out << "<h2>History</h2>\n<table><tr><th>When</th><th>Total</th><th>Critical path</th><th>Steps</th><th>Result</th></tr>\n";
+        for (auto it = history.rbegin(); it != history.rend(); ++it) {
+            std::time_t when = static_cast<std::time_t>(it->timestamp);
+            char date[32];
+            std::strftime(date, sizeof date, "%Y-%m-%d %H:%M:%S", std::localtime(&when));
+            out << "<tr><td>" << date << "</td><td>" << format_ms(it->total_ms) << "</td><td>" << format_ms(it->critical_ms)
+                << "</td><td>" << it->steps << "</td><td>" << (it->success ? "ok" : "failed") << "</td></tr>\n";
+        }
+        out << "</table>\n</body></html>\n";
+    }
+
+    void Timings::finish(bool success) {
+        Recorder& rec = recorder();
+        if (!rec.enabled) return;
+        rec.enabled = false;
+        double total_ms = now_ms();
+        const std::vector<TimingEvent>& events = rec.events;
+
+        int slots = 0;
+        for (const auto& event : events) slots = std::max(slots, event.slot);
+
+        std::vector<size_t> slowest(events.size());
+        for (size_t i = 0; i < events.size(); ++i) slowest[i] = i;
+        std::sort(slowest.begin(), slowest.end(), [&](size_t a, size_t b) { return events[a].duration_ms > events[b].duration_ms; });
+        if (slowest.size() > 10) slowest.resize(10);
+
+        std::vector<size_t> path = critical_path(events);
+        double critical_ms = 0;
+        for (size_t i : path) critical_ms += events[i].duration_ms;
+
+        std::vector<HistoryEntry> history = load_history();
+        const HistoryEntry* previous = history.empty() ? nullptr : &history.back();
+        std::vector<double> totals;
+        for (const auto& entry : history) {
+            if (entry.success) totals.push_back(entry.total_ms);
+        }
+        double previous_total = previous ? previous->total_ms : 0;
+
+        HistoryEntry current;
+        current.timestamp = static_cast<long long>(std::time(nullptr));
+        current.total_ms = total_ms;
+        current.critical_ms = critical_ms;
+        current.steps = events.size();
+        current.success = success;
+        history.push_back(current);
+        save_history(history);
+
+        fs::create_directories(fs::path(TRACE_PATH).parent_path());
+        write_trace(events, slots);
+        write_report(events, slowest, path, history, total_ms, slots);
+
+        std::cout << "\nBuild timings: " << format_ms(total_ms) << " total, " << events.size() << " steps\n";
+        if (!slowest.empty()) std::cout << "  Slowest steps:\n";
+        for (size_t i : slowest) {
+            const TimingEvent& event = events[i];
+            std::cout << "    " << std::setw(10) << format_ms(event.duration_ms) << "  " << std::setw(10) << std::left
+                      << event.category << std::right << " " << event.name;
+            if (event.peak_rss_kb > 0) std::cout << " (cpu " << format_ms(event.cpu_ms) << ", " << event.peak_rss_kb / 1024 << " MB)";
+            std::cout << "\n";
+        }
+        if (!path.empty()) {
+            std::cout << "  Critical path (" << format_ms(critical_ms) << "):";
+            for (size_t i = 0; i < path.size(); ++i) std::cout << (i ? " -> " : " ") << events[path[i]].name;
+            std::cout << "\n";
+        }
+        if (previous) {
+            double delta = total_ms - previous_total;
+            std::cout << "  Previous build: " << format_ms(previous_total) << " (" << (delta >= 0 ? "+" : "") << format_ms(delta) << ")";
+            if (totals.size() > 1) {
+                std::sort(totals.begin(), totals.end());
+                std::cout << ", median of last " << totals.size() << ": " << format_ms(totals[totals.size() / 2]);
+            }
+            std::cout << "\n";
+        }
+        std::cout << "  Trace: " << TRACE_PATH << ", report: " << REPORT_PATH << std::endl;
+        rec.events.clear();
+    }
+}
@@ -0,0 +1,114 @@
+#include "../../include/core/Toolchain.h"
+#include "../../include/core/Utils.h"
+#include "../../include/core/Timings.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    static std::string type_name(CompilerType type) {
+        switch (type) {
+            case CompilerType::GCC: return "gcc";
+            case CompilerType::Clang: return "clang";
+            case CompilerType::MSVC: return "msvc";
+            default: return "unknown";
+        }
+    }
+
+    static std::string first_line(const std::string& text) {
+        std::string line = text.substr(0, text.find('\n'));
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        return line;
+    }
+
+    static int64_t binary_mtime(const std::string& path) {
+        std::error_code ec;
+        // Follow symlinks such as /usr/bin/g++ -> g++-12 to the real binary
+        fs::path real = fs::canonical(path, ec);
+        if (ec) return 0;
+        auto mtime = fs::last_write_time(real, ec);
+        if (ec) return 0;
+        return static_cast<int64_t>(mtime.time_since_epoch().count());
+    }
+
+    // Text file of "key value" lines.
+    static bool load_fingerprint(std::map<std::string, std::string>& out) {
+        std::ifstream in(Toolchain::CACHE_PATH);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t space = line.find(' ');
+            if (space == std::string::npos) continue;
+            out[line.substr(0, space)] = line.substr(space + 1);
+        }
+        return true;
+    }
+
+    static void save_fingerprint(const ToolchainInfo& info) {
+        fs::create_directories(fs::path(Toolchain::CACHE_PATH).parent_path());
+        std::string tmp_path = std::string(Toolchain::CACHE_PATH) + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::trunc);
+            out << "command " << info.command << "\n"
+                << "type " << type_name(info.type) << "\n"
+                << "path " << info.path << "\n"
+                << "mtime " << info.mtime << "\n"
+                << "version " << info.version << "\n"
+                << "triple " << info.triple << "\n";
+            if (!out) return;
+        }
+        std::error_code ec;
+        fs::rename(tmp_path, Toolchain::CACHE_PATH, ec);
+    }
+
+    static void probe(ToolchainInfo& info) {
+        if (info.type == CompilerType::MSVC) {
+            // cl prints its banner (with the version and target architecture) when run bare
+            info.version = first_line(Timings::run(info.command, "probe", std::vector<std::string>{info.path}).output);
+            return;
+        }
+        info.version = first_line(Timings::run(info.command + " --version", "probe", std::vector<std::string>{info.path, "--version"}).output);
+        info.triple = first_line(Timings::run(info.command + " -dumpmachine", "probe", std::vector<std::string>{info.path, "-dumpmachine"}).output);
+    }
+
+    bool Toolchain::locate(ToolchainInfo& out) {
+        out = ToolchainInfo{};
+        const std::pair<const char*, CompilerType> candidates[] = {
+            {"clang++", CompilerType::Clang},
+            {"g++", CompilerType::GCC},
+            {"cl", CompilerType::MSVC},
+        };
+        for (const auto& [command, type] : candidates) {
+            std::string path = find_executable(command);
+            if (path.empty()) continue;
+            out.command = command;
+            out.type = type;
+            out.path = path;
+            break;
+        }
+        if (out.type == CompilerType::Unknown) return false;
+        out.mtime = binary_mtime(out.path);
+        return true;
+    }
+
+    bool Toolchain::detect(ToolchainInfo& out) {
+        if (!locate(out)) return false;
+        out.nvcc = command_exists("nvcc") ? "nvcc" : "";
+
+        std::map<std::string, std::string> cached;
+        if (load_fingerprint(cached) && cached["command"] == out.command && cached["path"] == out.path &&
+            cached["mtime"] == std::to_string(out.mtime) && !cached["version"].empty()) {
+            out.version = cached["version"];
+            out.triple = cached["triple"];
+            return true;
+        }
+
+        probe(out);
+        save_fingerprint(out);
+        return true;
+    }
+}
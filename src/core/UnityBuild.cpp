@@ -0,0 +1,66 @@
+#include "../../include/core/UnityBuild.h"
+#include "../../include/core/Utils.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    static const char* UNITY_DIR = "build/unity";
+
+    std::vector<std::string> UnityBuild::generate(std::vector<std::string> sources, size_t batch_size) {
+        if (batch_size == 0) batch_size = DEFAULT_BATCH_SIZE;
+        std::sort(sources.begin(), sources.end());
+
+        // Content-defined chunking over the sorted paths: a file whose path hash is divisible
+        // by batch_size starts a new batch, so boundaries do not shift when files are added
+        // or removed elsewhere. Batches are capped at twice the requested size.
+        std::vector<std::vector<std::string>> batches;
+        for (const auto& src : sources) {
+            bool boundary = hash_string(src) % batch_size == 0;
+            if (batches.empty() || boundary || batches.back().size() >= 2 * batch_size) {
+                batches.emplace_back();
+            }
+            batches.back().push_back(src);
+        }
+
+        fs::create_directories(UNITY_DIR);
+        std::vector<std::string> unity_sources;
+        std::set<std::string> keep;
+        for (const auto& batch : batches) {
+            // Named after the batch's first file so names survive batches being added before it
+            std::string name = "unity_" + to_hex(hash_string(batch.front())).substr(0, 8) + ".cpp";
+            fs::path path = fs::path(UNITY_DIR) / name;
+
+            std::ostringstream content;
+            content << "// Generated by mule for unity builds. Do not edit.\n";
+            for (const auto& src : batch) {
+                content << "#include \"" << fs::relative(src, UNITY_DIR).generic_string() << "\"\n";
+            }
+
+            // Only rewrite on change so untouched batches keep their timestamps
+            std::ifstream existing(path);
+            std::string current((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+            existing.close();
+            if (current != content.str()) {
+                std::ofstream(path) << content.str();
+            }
+
+            unity_sources.push_back(path.string());
+            keep.insert(name);
+        }
+
+        // Drop batches that no longer exist
+        for (const auto& entry : fs::directory_iterator(UNITY_DIR)) {
+            if (!keep.count(entry.path().filename().string())) {
+                std::error_code ec;
+                fs::remove(entry.path(), ec);
+            }
+        }
+        return unity_sources;
+    }
+}
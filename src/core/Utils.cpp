@@ -1,14 +1,63 @@
 #include "../../include/core/Utils.h"
+#include "../../include/core/Process.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <vector>
+#include <cstdlib>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
 
 namespace mule {
     bool command_exists(const std::string& cmd) {
+        return !find_executable(cmd).empty();
+    }
+
+    static bool is_executable_file(const fs::path& path) {
+        std::error_code ec;
+        if (!fs::is_regular_file(path, ec)) return false;
 #ifdef _WIN32
-        std::string check = cmd + " --version > NUL 2>&1";
+        return true;
 #else
-        std::string check = cmd + " --version > /dev/null 2>&1";
+        return access(path.c_str(), X_OK) == 0;
 #endif
-        return (std::system(check.c_str()) == 0);
+    }
+
+    std::string find_executable(const std::string& cmd) {
+#ifdef _WIN32
+        const char separator = ';';
+        const std::vector<std::string> suffixes = {"", ".exe", ".bat", ".cmd"};
+#else
+        const char separator = ':';
+        const std::vector<std::string> suffixes = {""};
+#endif
+        if (cmd.empty()) return "";
+        if (fs::path(cmd).has_parent_path()) {
+            for (const auto& suffix : suffixes) {
+                if (is_executable_file(cmd + suffix)) return cmd + suffix;
+            }
+            return "";
+        }
+
+        const char* path_env = std::getenv("PATH");
+        if (!path_env) return "";
+        std::stringstream dirs(path_env);
+        std::string dir;
+        while (std::getline(dirs, dir, separator)) {
+            if (dir.empty()) dir = ".";
+            for (const auto& suffix : suffixes) {
+                fs::path candidate = fs::path(dir) / (cmd + suffix);
+                if (is_executable_file(candidate)) return candidate.string();
+            }
+        }
+        return "";
     }
 
     void print_version() {
@@ -24,32 +73,80 @@ namespace mule {
     }
 
     std::string exec_cmd(const char* cmd) {
-        char buffer[128];
-        std::string result = "";
-#if defined(_MSC_VER)
-        FILE* pipe = _popen(cmd, "r");
-#else
-        FILE* pipe = popen(cmd, "r");
-#endif
-        if (!pipe) return "";
+        ProcessOptions options;
+        options.merge_stderr = false;
+        std::string result = Process::run(std::string(cmd), options).output;
+        if (!result.empty() && result.back() == '\n') result.pop_back();
+        return result;
+    }
+
+    int exec_cmd_status(const std::string& cmd, std::string& output) {
+        ProcessResult result = Process::run(cmd);
+        output = std::move(result.output);
+        return result.exit_code;
+    }
+
+    uint64_t hash_string(const std::string& data, uint64_t seed) {
+        uint64_t hash = seed;
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string to_hex(uint64_t value) {
+        std::ostringstream ss;
+        ss << std::hex << std::setw(16) << std::setfill('0') << value;
+        return ss.str();
+    }
+
+    bool parse_size(const std::string& value, uint64_t& out_bytes) {
         try {
-            while (fgets(buffer, sizeof buffer, pipe) != NULL) {
-                result += buffer;
-            }
+            size_t pos = 0;
+            double number = std::stod(value, &pos);
+            char unit = pos < value.size() ? static_cast<char>(toupper(value[pos])) : 'B';
+            if (unit == 'K') number *= 1024.0;
+            else if (unit == 'M') number *= 1024.0 * 1024;
+            else if (unit == 'G') number *= 1024.0 * 1024 * 1024;
+            else if (unit == 'T') number *= 1024.0 * 1024 * 1024 * 1024;
+            else if (unit != 'B') return false;
+            if (number <= 0) return false;
+            out_bytes = static_cast<uint64_t>(number);
+            return true;
         } catch (...) {
-#if defined(_MSC_VER)
-            _pclose(pipe);
-#else
-            pclose(pipe);
-#endif
-            throw;
+            return false;
         }
-#if defined(_MSC_VER)
-        _pclose(pipe);
+    }
+
+    bool hash_file(const std::string& path, uint64_t& out_hash) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        uint64_t hash = 14695981039346656037ULL;
+        char buffer[65536];
+        while (file.read(buffer, sizeof buffer) || file.gcount() > 0) {
+            std::streamsize n = file.gcount();
+            for (std::streamsize i = 0; i < n; ++i) {
+                hash ^= static_cast<unsigned char>(buffer[i]);
+                hash *= 1099511628211ULL;
+            }
+        }
+        out_hash = hash;
+        return true;
+    }
+
+    FileLock::FileLock(const std::string& path) {
+#ifndef _WIN32
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ >= 0) flock(fd_, LOCK_EX);
 #else
-        pclose(pipe);
+        (void)path;
+#endif
+    }
+
+    FileLock::~FileLock() {
+#ifndef _WIN32
+        if (fd_ >= 0) close(fd_);
 #endif
-        if (!result.empty() && result.back() == '\n') result.pop_back();
-        return result;
     }
 }
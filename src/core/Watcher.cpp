@@ -0,0 +1,308 @@
+#include "../../include/core/Watcher.h"
+#include "../../include/core/ConfigParser.h"
+#include "../../include/core/TestRunner.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <map>
+#include <set>
+#include <csignal>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+#ifdef __linux__
+    static volatile sig_atomic_t stop_requested = 0;
+
+    static void handle_stop_signal(int) {
+        stop_requested = 1;
+    }
+
+    static const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    // Quiet period after the last event before rebuilding, so saving several files (or an
+    // editor's write-then-rename) triggers a single build
+    static const int DEBOUNCE_MS = 50;
+
+    struct WatchState {
+        int fd = -1;
+        std::map<int, std::string> dirs; // Watch descriptor -> directory
+        int root_wd = -1;                // Project root, only mule.toml matters there
+    };
+
+    static void add_watch_recursive(WatchState& state, const std::string& dir) {
+        int wd = inotify_add_watch(state.fd, dir.c_str(), WATCH_MASK | IN_ONLYDIR);
+        if (wd < 0) return;
+        state.dirs[wd] = dir;
+
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            if (entry.is_directory(ec) && !entry.is_symlink(ec)) add_watch_recursive(state, entry.path().string());
+        }
+    }
+
+    // Directories whose contents can affect the build.
+    static std::vector<std::string> watch_roots(const Config& config) {
+        std::set<std::string> roots = {"src", "include", "tests"};
+        for (const auto& dir : config.build.include_dirs) {
+            fs::path path = fs::path(dir).lexically_normal();
+            if (dir.empty() || path.is_absolute()) continue;
+            std::string first = path.begin()->string();
+            if (first == ".." || first == "build" || first == ".mule") continue;
+            roots.insert(path.generic_string());
+        }
+
+        std::vector<std::string> existing;
+        for (const auto& root : roots) {
+            if (fs::is_directory(root)) existing.push_back(root);
+        }
+        return existing;
+    }
+
+    // Editor swap and backup files never affect the build.
+    static bool is_ignored_name(const std::string& name) {
+        if (name.empty() || name[0] == '.' || name[0] == '#' || name.back() == '~') return true;
+        if (name == "4913") return true; // Vim's write probe
+        std::string ext = fs::path(name).extension().string();
+        return ext == ".swp" || ext == ".swx" || ext == ".tmp";
+    }
+
+    static int64_t realtime_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    static int64_t mtime_ns(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return 0;
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    }
+
+    struct ChangeSet {
+        std::set<std::string> files;
+        bool config_changed = false;
+        bool layout_changed = false; // Files were added, removed or renamed
+        bool overflow = false;       // Events were lost, everything must be re-checked
+    };
+
+    // Reads whatever events are queued. Returns false if the fd is unusable.
+    static bool read_events(WatchState& state, ChangeSet& changes) {
+        alignas(inotify_event) char buffer[16384];
+        while (true) {
+            ssize_t len = read(state.fd, buffer, sizeof buffer);
+            if (len < 0) return errno == EAGAIN || errno == EINTR;
+            if (len == 0) return true;
+
+            for (char* ptr = buffer; ptr < buffer + len;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    changes.overflow = true;
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    state.dirs.erase(event->wd);
+                    continue;
+                }
+                auto dir = state.dirs.find(event->wd);
+                if (dir == state.dirs.end() || event->len == 0) continue;
+
+                std::string name = event->name;
+                if (event->wd == state.root_wd) {
+                    if (name == "mule.toml") changes.config_changed = true;
+                    continue;
+                }
+                if (is_ignored_name(name)) continue;
+
+                std::string path = dir->second + "/" + name;
+                if (event->mask & IN_ISDIR) {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) add_watch_recursive(state, path);
+                    changes.layout_changed = true;
+                    changes.overflow = true; // Files inside a moved directory were never reported
+                    continue;
+                }
+                if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) changes.layout_changed = true;
+                changes.files.insert(path);
+            }
+        }
+    }
+
+    static bool wait_for_changes(WatchState& state, ChangeSet& changes) {
+        pollfd pfd{state.fd, POLLIN, 0};
+        while (!stop_requested) {
+            int ready = poll(&pfd, 1, -1);
+            if (ready < 0 && errno != EINTR) return false;
+            if (ready > 0 && !read_events(state, changes)) return false;
+            if (changes.files.empty() && !changes.config_changed && !changes.overflow) continue;
+
+            // Keep collecting until the burst of events is over
+            while (!stop_requested && poll(&pfd, 1, DEBOUNCE_MS) > 0) {
+                if (!read_events(state, changes)) return false;
+            }
+            return !stop_requested;
+        }
+        return false;
+    }
+
+    static bool start_session(Config& config, BuildSession& session, WatchState& state) {
+        if (!fs::exists("mule.toml")) {
+            std::cerr << "Error: mule.toml not found." << std::endl;
+            return false;
+        }
+        try {
+            config = ConfigParser::parse("mule.toml");
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return false;
+        }
+        std::vector<std::string> roots = watch_roots(config);
+        for (const auto& root : roots) add_watch_recursive(state, root);
+
+        session = BuildSession{};
+        session.db.set_trusted_roots(roots);
+        return true;
+    }
+
+    static bool daemonize() {
+        fs::create_directories(".mule");
+        std::ifstream pid_in(Watcher::PID_PATH);
+        pid_t existing = 0;
+        if (pid_in >> existing && existing > 0 && kill(existing, 0) == 0) {
+            std::cerr << "Error: mule watch is already running (pid " << existing << ")." << std::endl;
+            return false;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Error: failed to start the watch daemon: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (pid > 0) {
+            std::cout << "mule watch running in the background (pid " << pid << "), logging to " << Watcher::LOG_PATH << std::endl;
+            std::exit(0);
+        }
+
+        setsid();
+        int null_fd = open("/dev/null", O_RDONLY);
+        int log_fd = open(Watcher::LOG_PATH, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (null_fd >= 0) dup2(null_fd, STDIN_FILENO);
+        if (log_fd >= 0) {
+            dup2(log_fd, STDOUT_FILENO);
+            dup2(log_fd, STDERR_FILENO);
+        }
+        if (null_fd > STDERR_FILENO) close(null_fd);
+        if (log_fd > STDERR_FILENO) close(log_fd);
+
+        std::ofstream(Watcher::PID_PATH) << getpid() << "\n";
+        return true;
+    }
+
+    int Watcher::watch(const BuildOptions& options, const WatchOptions& watch_options) {
+        if (watch_options.daemon && !daemonize()) return 1;
+        std::signal(SIGINT, handle_stop_signal);
+        std::signal(SIGTERM, handle_stop_signal);
+
+        WatchState state;
+        state.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (state.fd < 0) {
+            std::cerr << "Error: inotify is not available: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        state.root_wd = inotify_add_watch(state.fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        state.dirs[state.root_wd] = ".";
+
+        Config config;
+        BuildSession session;
+        if (!start_session(config, session, state)) return 1;
+
+        int64_t edit_time = 0;
+        size_t changed_count = 0;
+        while (true) {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = Builder::build(config, options, session);
+            auto build_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+            if (!ok) {
+                std::cout << "[watch] Build failed after " << build_ms << " ms." << std::endl;
+            } else if (edit_time > 0) {
+                int64_t latency_ms = (realtime_ns() - edit_time) / 1000000;
+                std::cout << "[watch] Rebuilt in " << build_ms << " ms (" << changed_count << " file(s) changed), edit to binary: "
+                          << latency_ms << " ms." << std::endl;
+            } else {
+                std::cout << "[watch] Built in " << build_ms << " ms." << std::endl;
+            }
+
+            if (ok && watch_options.test) TestRunner::run_tests(config, options);
+            if (ok && watch_options.run && config.type != "static-lib" && config.type != "shared-lib") Builder::run_binary(config);
+            std::cout << "[watch] Watching for changes (Ctrl+C to stop)..." << std::endl;
+
+            ChangeSet changes;
+            if (!wait_for_changes(state, changes)) break;
+
+            // The earliest modification is when the edit being waited on happened. Files
+            // that are already gone (editor temporaries, deletions) are not counted.
+            edit_time = realtime_ns();
+            changed_count = 0;
+            for (const auto& file : changes.files) {
+                int64_t mtime = mtime_ns(file);
+                if (mtime == 0) continue;
+                ++changed_count;
+                if (mtime < edit_time) edit_time = mtime;
+            }
+
+            if (changes.config_changed) {
+                std::cout << "[watch] mule.toml changed, reloading configuration." << std::endl;
+                if (!start_session(config, session, state)) break;
+                continue;
+            }
+            if (changes.overflow) session.db.invalidate_all();
+            for (const auto& file : changes.files) session.db.invalidate(file);
+            if (changes.layout_changed) session.sources_indexed = false;
+        }
+
+        close(state.fd);
+        if (watch_options.daemon) fs::remove(PID_PATH);
+        std::cout << "[watch] Stopped." << std::endl;
+        return 0;
+    }
+
+    int Watcher::stop() {
+        std::ifstream pid_in(PID_PATH);
+        pid_t pid = 0;
+        if (!(pid_in >> pid) || pid <= 0 || kill(pid, 0) != 0) {
+            std::cout << "No mule watch daemon is running." << std::endl;
+            fs::remove(PID_PATH);
+            return 0;
+        }
+        if (kill(pid, SIGTERM) != 0) {
+            std::cerr << "Error: failed to stop mule watch (pid " << pid << "): " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        std::cout << "Stopped mule watch (pid " << pid << ")." << std::endl;
+        return 0;
+    }
+#else
+    int Watcher::watch(const BuildOptions&, const WatchOptions&) {
+        std::cerr << "Error: mule watch needs inotify and is only available on Linux." << std::endl;
+        return 1;
+    }
+
+    int Watcher::stop() {
+        std::cerr << "Error: mule watch needs inotify and is only available on Linux." << std::endl;
+        return 1;
+    }
+#endif
+}
@@ -0,0 +1,123 @@
+#include "../../include/core/Workspace.h"
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <functional>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace mule {
+
+    // Member directories named by the members list, in order, with "dir/*" expanded.
+    static std::vector<fs::path> member_dirs(const std::vector<std::string>& patterns) {
+        std::vector<fs::path> dirs;
+        for (const auto& pattern : patterns) {
+            fs::path path = pattern;
+            if (path.filename() != "*") {
+                dirs.push_back(path.lexically_normal());
+                continue;
+            }
+            std::vector<fs::path> matches;
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(path.parent_path(), ec)) {
+                if (entry.is_directory() && fs::exists(entry.path() / "mule.toml")) matches.push_back(entry.path().lexically_normal());
+            }
+            std::sort(matches.begin(), matches.end());
+            dirs.insert(dirs.end(), matches.begin(), matches.end());
+        }
+        return dirs;
+    }
+
+    static bool same_source(const Dependency& a, const Dependency& b) {
+        return a.git == b.git && a.tag == b.tag && a.commit == b.commit && a.subdir == b.subdir && a.path == b.path;
+    }
+
+    bool Workspace::load(const Config& root, Workspace& out) {
+        out = Workspace{};
+        std::map<std::string, MulePackage> members;
+        std::vector<std::string> order; // Names in members list order
+        std::map<std::string, std::string> by_dir; // Canonical directory -> member name
+        for (const auto& dir : member_dirs(root.workspace.members)) {
+            fs::path manifest = dir / "mule.toml";
+            if (!fs::exists(manifest)) {
+                std::cerr << "Error: workspace member '" << dir.string() << "' has no mule.toml." << std::endl;
+                return false;
+            }
+            MulePackage member;
+            member.path = dir.string();
+            try {
+                member.config = ConfigParser::parse(manifest.string());
+            } catch (const std::exception& e) {
+                std::cerr << "Error: workspace member '" << dir.string() << "': " << e.what() << std::endl;
+                return false;
+            }
+            member.name = member.config.project_name.empty() ? dir.filename().string() : member.config.project_name;
+            if (members.count(member.name)) {
+                std::cerr << "Error: workspace members " << members[member.name].path << " and " << member.path
+                          << " are both named '" << member.name << "'." << std::endl;
+                return false;
+            }
+            by_dir[fs::canonical(dir).string()] = member.name;
+            order.push_back(member.name);
+            members[member.name] = member;
+        }
+
+        // Path dependencies on other members become edges, everything else is fetched once
+        // for the whole workspace
+        std::map<std::string, std::string> declared_by; // Outside dependency -> first member declaring it
+        bool ok = true;
+        for (const auto& name : order) {
+            MulePackage& member = members[name];
+            for (Dependency dep : member.config.dependencies) {
+                if (!dep.path.empty()) {
+                    fs::path target = fs::absolute(fs::path(member.path) / dep.path).lexically_normal();
+                    std::error_code ec;
+                    auto it = by_dir.find(fs::canonical(target, ec).string());
+                    if (!ec && it != by_dir.end()) {
+                        member.dependencies.push_back(it->second);
+                        continue;
+                    }
+                    dep.path = target.string();
+                }
+                auto existing = std::find_if(out.dependencies.begin(), out.dependencies.end(),
+                                             [&](const Dependency& other) { return other.name == dep.name; });
+                if (existing == out.dependencies.end()) {
+                    out.dependencies.push_back(dep);
+                    declared_by[dep.name] = name;
+                } else if (!same_source(*existing, dep)) {
+                    std::cerr << "Error: workspace members " << declared_by[dep.name] << " and " << name
+                              << " declare different sources for " << dep.name << "." << std::endl;
+                    ok = false;
+                }
+            }
+        }
+        if (!ok) return false;
+
+        // Depth-first, emitting a member once everything it depends on has been
+        std::map<std::string, int> state; // 1 = on the current path, 2 = emitted
+        std::vector<std::string> path;
+        std::function<bool(const std::string&)> visit = [&](const std::string& name) {
+            if (state[name] == 2) return true;
+            if (state[name] == 1) {
+                std::cerr << "Error: workspace dependency cycle:";
+                for (auto it = std::find(path.begin(), path.end(), name); it != path.end(); ++it) std::cerr << " " << *it << " ->";
+                std::cerr << " " << name << std::endl;
+                return false;
+            }
+            state[name] = 1;
+            path.push_back(name);
+            for (const auto& dep : members[name].dependencies) {
+                if (!visit(dep)) return false;
+            }
+            path.pop_back();
+            state[name] = 2;
+            out.members.push_back(members[name]);
+            return true;
+        };
+        for (const auto& name : order) {
+            if (!visit(name)) return false;
+        }
+        return true;
+    }
+}
@@ -7,19 +7,96 @@
 #include "../include/core/Utils.h"
 #include "../include/core/PackageManager.h"
 #include "../include/core/TestRunner.h"
+#include "../include/core/CompileCache.h"
+#include "../include/core/Watcher.h"
+#include "../include/core/Analyzer.h"
+#include "../include/core/Store.h"
+#include "../include/core/Workspace.h"
 
 void print_help() {
     std::cout << "Mule: A minimalist C++ build system and package manager\n\n"
               << "Usage: mule <command> [args]\n\n"
               << "Commands:\n"
               << "  new <name> [--lib]  Create a new project or library structure\n"
-              << "  build               Compile the project based on mule.toml\n"
+              << "  build [-j N]        Compile the project based on mule.toml\n"
               << "  run                 Build and execute the project binary\n"
               << "  clean               Remove the build directory\n"
-              << "  fetch               Download dependencies listed in mule.toml\n"
+              << "  fetch [--update]    Download dependencies listed in mule.toml (--update ignores mule.lock)\n"
               << "  test                Run tests found in tests/ (integration style)\n"
+              << "  watch [--run]       Rebuild on every source change (--test, --daemon, --stop)\n"
+              << "  analyze headers     Rank headers, templates and functions by compile time (clang, --top N)\n"
+              << "  cache stats         Show compile cache size and hit rate\n"
+              << "  cache clear         Remove every entry from the compile cache\n"
+              << "  store gc            Remove dependency checkouts no project's mule.lock references\n"
               << "  --help, -h          Display this help message\n"
-              << "  --version, -v       Display version information\n";
+              << "  --version, -v       Display version information\n\n"
+              << "Build options:\n"
+              << "  -j, --jobs <N>      Number of parallel compile jobs (default: all cores)\n"
+              << "  --no-cache          Do not use the shared compile cache\n"
+              << "  --unity             Compile sources in unity (jumbo) batches\n"
+              << "  --release           Optimized build (-O2, NDEBUG); dependencies built as Release\n"
+              << "  --timings           Write a trace and report of every build step to build/timings/\n"
+              << "  --offline           Use only dependencies already in the store; never fetch\n"
+              << "  --locked            Fail if mule.lock is missing or does not match mule.toml\n"
+              << "  --mem-limit <size>  Memory the parallel jobs may use together (default: 80% of available RAM)\n";
+}
+
+// Parses the options shared by build, run and test. Returns false on a malformed option.
+bool parse_build_options(int argc, char *argv[], mule::BuildOptions& options) {
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+        if (arg == "-j" || arg == "--jobs") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: '" << arg << "' requires a number." << std::endl;
+                return false;
+            }
+            value = argv[++i];
+        } else if (arg.rfind("-j", 0) == 0) {
+            value = arg.substr(2);
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            value = arg.substr(7);
+        } else if (arg == "--no-cache") {
+            options.use_cache = false;
+            continue;
+        } else if (arg == "--unity") {
+            options.unity = true;
+            continue;
+        } else if (arg == "--release") {
+            options.release = true;
+            continue;
+        } else if (arg == "--timings") {
+            options.timings = true;
+            continue;
+        } else if (arg == "--offline") {
+            options.offline = true;
+            continue;
+        } else if (arg == "--locked") {
+            options.locked = true;
+            continue;
+        } else if (arg == "--mem-limit" || arg.rfind("--mem-limit=", 0) == 0) {
+            std::string size = arg.size() > 11 ? arg.substr(12) : (i + 1 < argc ? argv[++i] : "");
+            uint64_t bytes;
+            if (!mule::parse_size(size, bytes)) {
+                std::cerr << "Error: invalid memory limit '" << size << "' (e.g. 8G, 512M)." << std::endl;
+                return false;
+            }
+            options.mem_limit_kb = static_cast<long>(bytes / 1024);
+            continue;
+        } else {
+            continue;
+        }
+        try {
+            options.jobs = std::stoi(value);
+        } catch (...) {
+            options.jobs = -1;
+        }
+        if (options.jobs <= 0) {
+            std::cerr << "Error: invalid job count '" << value << "'." << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
 int main(int argc, char *argv[]) {
@@ -53,28 +130,105 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    if (cmd == "cache") {
+        std::string sub = argc >= 3 ? argv[2] : "stats";
+        if (sub == "stats") {
+            mule::CompileCache::print_stats();
+        } else if (sub == "clear") {
+            mule::CompileCache::clear();
+        } else {
+            std::cerr << "Unknown cache command: " << sub << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (cmd == "store") {
+        std::string sub = argc >= 3 ? argv[2] : "";
+        if (sub == "gc") return mule::Store::gc();
+        std::cerr << "Unknown store command: " << sub << "\n";
+        return 1;
+    }
+
     // Commands that require a config
     mule::Config config;
     try {
-        if (cmd == "build" || cmd == "run" || cmd == "fetch" || cmd == "test") {
+        if (cmd == "build" || cmd == "run" || cmd == "fetch" || cmd == "test" || cmd == "analyze") {
             config = mule::ConfigParser::parse("mule.toml");
         }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
     } catch (...) {
         // Config parser handles its own caching/error reporting mostly, but good to be safe
         return 1;
     }
 
-    if (cmd == "build") {
-        mule::Builder::build(config);
+    mule::BuildOptions options;
+    if (!parse_build_options(argc, argv, options)) {
+        return 1;
+    }
+
+    // A workspace root has no sources of its own; only build and fetch apply to it
+    bool is_workspace = !config.workspace.members.empty();
+    if (is_workspace && cmd != "build" && cmd != "fetch" && cmd != "clean") {
+        std::cerr << "Error: '" << cmd << "' is not supported in a workspace root; run it in a member directory." << std::endl;
+        return 1;
+    }
+
+    if (cmd == "watch") {
+        mule::WatchOptions watch_options;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--run") watch_options.run = true;
+            else if (arg == "--test") watch_options.test = true;
+            else if (arg == "--daemon") watch_options.daemon = true;
+            else if (arg == "--stop") return mule::Watcher::stop();
+        }
+        return mule::Watcher::watch(options, watch_options);
+    } else if (cmd == "analyze") {
+        std::string what = argc >= 3 ? argv[2] : "";
+        if (what != "headers") {
+            std::cerr << "Error: usage: mule analyze headers [--top N]" << std::endl;
+            return 1;
+        }
+        size_t top = 20;
+        for (int i = 3; i + 1 < argc; ++i) {
+            if (std::string(argv[i]) == "--top") {
+                try {
+                    top = std::stoul(argv[i + 1]);
+                } catch (...) {
+                    std::cerr << "Error: invalid count '" << argv[i + 1] << "'." << std::endl;
+                    return 1;
+                }
+            }
+        }
+        return mule::Analyzer::analyze_headers(config, options, top);
+    } else if (cmd == "build") {
+        if (is_workspace) return mule::Builder::build_workspace(config, options) ? 0 : 1;
+        if (!mule::Builder::build(config, options)) return 1;
     } else if (cmd == "run") {
-        mule::Builder::run(config);
+        mule::Builder::run(config, options);
     } else if (cmd == "clean") {
         mule::Builder::clean();
     } else if (cmd == "fetch") {
-        auto resolved = mule::PackageManager::fetch_dependencies(config.dependencies);
-        mule::PackageManager::write_lockfile(resolved);
+        mule::FetchOptions fetch_options;
+        fetch_options.offline = options.offline;
+        fetch_options.locked = options.locked;
+        for (int i = 2; i < argc; ++i) {
+            if (std::string(argv[i]) == "--update") fetch_options.update = true;
+        }
+        std::vector<mule::Dependency> dependencies = config.dependencies;
+        if (is_workspace) {
+            mule::Workspace workspace;
+            if (!mule::Workspace::load(config, workspace)) return 1;
+            dependencies = workspace.dependencies;
+        }
+        std::vector<mule::Dependency> resolved;
+        if (!mule::PackageManager::fetch_dependencies(dependencies, fetch_options, resolved)) return 1;
+        if (!fetch_options.locked) mule::PackageManager::write_lockfile(resolved);
     } else if (cmd == "test") {
-        mule::TestRunner::run_tests(config);
+        mule::TestRunner::run_tests(config, options);
     } else {
         std::cerr << "Unknown command: " << cmd << "\n";
         print_help();